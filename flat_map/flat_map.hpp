@@ -0,0 +1,420 @@
+/**
+ * implement a container like std::flat_map
+ */
+#ifndef SJTU_FLAT_MAP_HPP
+#define SJTU_FLAT_MAP_HPP
+
+// only for std::less<T>
+#include <functional>
+#include <cstddef>
+#include "utility.hpp"
+#include "exceptions.hpp"
+#include "../vector/vector.hpp"
+
+namespace sjtu {
+
+/**
+ * an ordered map kept in two sorted sjtu::vector,
+ *   one for the keys and one for the mapped values,
+ *   so a lookup is a binary search over the keys only.
+ * it has the interface of sjtu::map except for the node handles
+ *   (extract, insert of a node_type and merge), as there are no nodes to hand over.
+ * lookups and iteration are faster and a map costs no memory besides its elements,
+ *   while insert and erase move the elements behind pos: O(n).
+ * use replace() to build the whole map at once from sorted data.
+ * iterators are invalidated by insert and erase.
+ */
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>
+> class flat_map {
+public:
+	typedef pair<const Key, T> value_type;
+	/**
+	 * keys and values are stored apart, so the iterators return
+	 *   a pair of references instead of a reference to value_type.
+	 */
+	typedef pair<const Key &, T &> reference;
+	typedef pair<const Key &, const T &> const_reference;
+
+private:
+	vector<Key> keys;
+	vector<T> values;
+	Compare cmp;
+
+	/**
+	 * index of the first key not less than key.
+	 * the loop halves the range without a data dependent branch,
+	 *   so the compiler can use conditional moves.
+	 */
+	template<class K>
+	size_t lower_index(const K &key) const
+	{
+		const Key *base = keys.data();
+		size_t len = keys.size();
+		if (len == 0) return 0;
+		while (len > 1)
+		{
+			size_t half = len >> 1;
+			base = (cmp(base[half - 1], key) ? base + half : base);
+			len -= half;
+		}
+		return (base - keys.data()) + (cmp(*base, key) ? 1 : 0);
+	}
+
+	/**
+	 * index of the first key greater than key.
+	 */
+	template<class K>
+	size_t upper_index(const K &key) const
+	{
+		const Key *base = keys.data();
+		size_t len = keys.size();
+		if (len == 0) return 0;
+		while (len > 1)
+		{
+			size_t half = len >> 1;
+			base = (cmp(key, base[half - 1]) ? base : base + half);
+			len -= half;
+		}
+		return (base - keys.data()) + (cmp(key, *base) ? 0 : 1);
+	}
+
+	/**
+	 * index of key, size() if there is no such key.
+	 */
+	template<class K>
+	size_t find_index(const K &key) const
+	{
+		size_t pos = lower_index(key);
+		if (pos != keys.size() && !cmp(key, keys.data()[pos])) return pos;
+		return keys.size();
+	}
+
+	/**
+	 * insert key and value at index pos of the two vectors.
+	 * if the value cannot be inserted the key is removed again,
+	 *   so the map is unchanged and the vectors stay in step.
+	 */
+	void insert_at(size_t pos, const Key &key, const T &value)
+	{
+		keys.insert(pos, key);
+		try
+		{
+			values.insert(pos, value);
+		}
+		catch (...)
+		{
+			keys.erase(pos);
+			throw;
+		}
+	}
+
+public:
+	/**
+	 * see BidirectionalIterator at CppReference for help.
+	 *
+	 * if there is anything wrong throw invalid_iterator.
+	 *     like it = map.begin(); --it;
+	 *       or it = map.end(); ++end();
+	 */
+	class const_iterator;
+	class iterator {
+		friend class flat_map;
+		friend class const_iterator;
+		flat_map *owner;
+		size_t pos;
+	public:
+		/**
+		 * it->first and it->second point into the two vectors.
+		 */
+		class pointer {
+			reference ref;
+		public:
+			pointer(const reference &other) :ref(other){}
+			reference * operator->() { return &ref; }
+		};
+		iterator() :owner(NULL), pos(0){}
+		iterator(flat_map *other_owner, size_t other_pos) :owner(other_owner), pos(other_pos){}
+		iterator & operator++()
+		{
+			if (!owner || pos >= owner->size()) throw invalid_iterator();
+			++pos;
+			return *this;
+		}
+		iterator operator++(int)
+		{
+			iterator ans(*this);
+			++*this;
+			return ans;
+		}
+		iterator & operator--()
+		{
+			if (!owner || pos == 0) throw invalid_iterator();
+			--pos;
+			return *this;
+		}
+		iterator operator--(int)
+		{
+			iterator ans(*this);
+			--*this;
+			return ans;
+		}
+		reference operator*() const { return reference(owner->keys.data()[pos], owner->values.data()[pos]); }
+		pointer operator->() const { return pointer(**this); }
+		bool operator==(const iterator &rhs) const { return owner == rhs.owner && pos == rhs.pos; }
+		bool operator==(const const_iterator &rhs) const { return owner == rhs.owner && pos == rhs.pos; }
+		bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+		bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
+	};
+	class const_iterator {
+		friend class flat_map;
+		friend class iterator;
+		const flat_map *owner;
+		size_t pos;
+	public:
+		class pointer {
+			const_reference ref;
+		public:
+			pointer(const const_reference &other) :ref(other){}
+			const_reference * operator->() { return &ref; }
+		};
+		const_iterator() :owner(NULL), pos(0){}
+		const_iterator(const flat_map *other_owner, size_t other_pos) :owner(other_owner), pos(other_pos){}
+		const_iterator(const iterator &other) :owner(other.owner), pos(other.pos){}
+		const_iterator & operator++()
+		{
+			if (!owner || pos >= owner->size()) throw invalid_iterator();
+			++pos;
+			return *this;
+		}
+		const_iterator operator++(int)
+		{
+			const_iterator ans(*this);
+			++*this;
+			return ans;
+		}
+		const_iterator & operator--()
+		{
+			if (!owner || pos == 0) throw invalid_iterator();
+			--pos;
+			return *this;
+		}
+		const_iterator operator--(int)
+		{
+			const_iterator ans(*this);
+			--*this;
+			return ans;
+		}
+		const_reference operator*() const { return const_reference(owner->keys.data()[pos], owner->values.data()[pos]); }
+		pointer operator->() const { return pointer(**this); }
+		bool operator==(const iterator &rhs) const { return owner == rhs.owner && pos == rhs.pos; }
+		bool operator==(const const_iterator &rhs) const { return owner == rhs.owner && pos == rhs.pos; }
+		bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+		bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
+	};
+
+	flat_map() {}
+	flat_map(const flat_map &other) :keys(other.keys), values(other.values){}
+	flat_map & operator=(const flat_map &other)
+	{
+		if (this == &other) return *this;
+		keys = other.keys;
+		values = other.values;
+		return *this;
+	}
+	~flat_map() {}
+	/**
+	 * replace the whole content by sorted_keys and values, where values[i] is mapped by sorted_keys[i].
+	 * sorted_keys must be strictly increasing and as long as values,
+	 *   otherwise runtime_error is thrown and the map is unchanged.
+	 */
+	void replace(const vector<Key> &sorted_keys, const vector<T> &values)
+	{
+		if (sorted_keys.size() != values.size()) throw runtime_error("flat_map::replace: sizes of keys and values differ.");
+		const Key *base = sorted_keys.data();
+		for (size_t i = 1; i < sorted_keys.size(); ++i)
+		{
+			if (!cmp(base[i - 1], base[i])) throw runtime_error("flat_map::replace: keys are not sorted and unique.");
+		}
+		this->keys = sorted_keys;
+		this->values = values;
+	}
+	/**
+	 * make room for n elements, so that the next inserts do not reallocate.
+	 */
+	void reserve(size_t n)
+	{
+		keys.reserve(n);
+		values.reserve(n);
+	}
+	/**
+	 * access specified element with bounds checking,
+	 *   throw index_out_of_bound if no such element exists.
+	 */
+	T & at(const Key &key)
+	{
+		size_t pos = find_index(key);
+		if (pos == keys.size()) throw index_out_of_bound();
+		return values.data()[pos];
+	}
+	const T & at(const Key &key) const
+	{
+		size_t pos = find_index(key);
+		if (pos == keys.size()) throw index_out_of_bound();
+		return values.data()[pos];
+	}
+	/**
+	 * the overloads templated on K take any key type comparable with Key,
+	 *   they are only available when Compare::is_transparent exists (like std::less<>).
+	 */
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	T & at(const K &key)
+	{
+		size_t pos = find_index(key);
+		if (pos == keys.size()) throw index_out_of_bound();
+		return values.data()[pos];
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const T & at(const K &key) const
+	{
+		size_t pos = find_index(key);
+		if (pos == keys.size()) throw index_out_of_bound();
+		return values.data()[pos];
+	}
+	/**
+	 * access specified element, performing an insertion if such key does not already exist.
+	 */
+	T & operator[](const Key &key)
+	{
+		size_t pos = lower_index(key);
+		if (pos == keys.size() || cmp(key, keys.data()[pos]))
+		{
+			insert_at(pos, key, T());
+		}
+		return values.data()[pos];
+	}
+	/**
+	 * behave like at() throw index_out_of_bound if such key does not exist.
+	 */
+	const T & operator[](const Key &key) const { return at(key); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	T & operator[](const K &key)
+	{
+		size_t pos = lower_index(key);
+		if (pos == keys.size() || cmp(key, keys.data()[pos]))
+		{
+			insert_at(pos, Key(key), T());
+		}
+		return values.data()[pos];
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const T & operator[](const K &key) const { return at(key); }
+	iterator begin() { return iterator(this, 0); }
+	const_iterator cbegin() const { return const_iterator(this, 0); }
+	iterator end() { return iterator(this, keys.size()); }
+	const_iterator cend() const { return const_iterator(this, keys.size()); }
+	bool empty() const { return keys.empty(); }
+	size_t size() const { return keys.size(); }
+	void clear()
+	{
+		keys.clear();
+		values.clear();
+	}
+	/**
+	 * insert an element.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 */
+	pair<iterator, bool> insert(const value_type &value)
+	{
+		size_t pos = lower_index(value.first);
+		if (pos != keys.size() && !cmp(value.first, keys.data()[pos]))
+			return pair<iterator, bool>(iterator(this, pos), false);
+		insert_at(pos, value.first, value.second);
+		return pair<iterator, bool>(iterator(this, pos), true);
+	}
+	/**
+	 * erase the element at pos.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	void erase(iterator pos)
+	{
+		if (pos.owner != this || pos.pos >= keys.size()) throw index_out_of_bound();
+		keys.erase(pos.pos);
+		values.erase(pos.pos);
+	}
+	/**
+	 * erase the element with key, return how many were erased (0 or 1).
+	 */
+	size_t erase(const Key &key)
+	{
+		size_t pos = find_index(key);
+		if (pos == keys.size()) return 0;
+		keys.erase(pos);
+		values.erase(pos);
+		return 1;
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	size_t erase(const K &key)
+	{
+		size_t pos = find_index(key);
+		if (pos == keys.size()) return 0;
+		keys.erase(pos);
+		values.erase(pos);
+		return 1;
+	}
+	size_t count(const Key &key) const { return find_index(key) == keys.size() ? 0 : 1; }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	size_t count(const K &key) const { return find_index(key) == keys.size() ? 0 : 1; }
+	iterator find(const Key &key) { return iterator(this, find_index(key)); }
+	const_iterator find(const Key &key) const { return const_iterator(this, find_index(key)); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator find(const K &key) { return iterator(this, find_index(key)); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator find(const K &key) const { return const_iterator(this, find_index(key)); }
+	/**
+	 * the first element not less than key / greater than key, end() if there is none.
+	 */
+	iterator lower_bound(const Key &key) { return iterator(this, lower_index(key)); }
+	const_iterator lower_bound(const Key &key) const { return const_iterator(this, lower_index(key)); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator lower_bound(const K &key) { return iterator(this, lower_index(key)); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator lower_bound(const K &key) const { return const_iterator(this, lower_index(key)); }
+	iterator upper_bound(const Key &key) { return iterator(this, upper_index(key)); }
+	const_iterator upper_bound(const Key &key) const { return const_iterator(this, upper_index(key)); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator upper_bound(const K &key) { return iterator(this, upper_index(key)); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator upper_bound(const K &key) const { return const_iterator(this, upper_index(key)); }
+	/**
+	 * Returns the range of elements with key equivalent to key,
+	 *   as a pair of lower_bound() and upper_bound().
+	 */
+	pair<iterator, iterator> equal_range(const Key &key)
+	{
+		return pair<iterator, iterator>(lower_bound(key), upper_bound(key));
+	}
+	pair<const_iterator, const_iterator> equal_range(const Key &key) const
+	{
+		return pair<const_iterator, const_iterator>(lower_bound(key), upper_bound(key));
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	pair<iterator, iterator> equal_range(const K &key)
+	{
+		return pair<iterator, iterator>(lower_bound(key), upper_bound(key));
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	pair<const_iterator, const_iterator> equal_range(const K &key) const
+	{
+		return pair<const_iterator, const_iterator>(lower_bound(key), upper_bound(key));
+	}
+};
+
+}
+
+#endif
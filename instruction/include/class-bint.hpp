@@ -2,12 +2,38 @@
 #include <iostream>
 #include <cstring>
 #include <cstdlib>
+#include <cstdint>
 #include <vector>
 #include <stdexcept>
+#include <utility>
 
 namespace Util {
 
-const size_t MIN_CAPACITY = 2048;
+/**
+ * Limbs stored inside a Bint. Longer magnitudes get a heap buffer of their own length,
+ * which grows at least twofold when a Bint is assigned a longer value.
+ */
+const size_t MIN_CAPACITY = 2;
+
+namespace Kernel {
+
+/**
+ * Magnitudes are little-endian arrays of 64-bit limbs: the value of a[0..n) is sum a[i] 2^(64 i).
+ */
+typedef uint64_t Limb;
+typedef unsigned __int128 WideLimb;
+
+/**
+ * A divisor d != 0 prepared for dividing by it with multiplications:
+ * d shifted left until its top bit is set and floor((2^128 - 1) / d) - 2^64 of the shifted d.
+ */
+struct LimbDivisor {
+	Limb d, inv;
+	unsigned shift;
+	explicit LimbDivisor(const Limb &divisor);
+};
+
+}
 
 class Bint {
 	class NewSpaceFailed : public std::runtime_error {
@@ -18,13 +44,24 @@ class Bint {
 	public:
 		BadCast();
 	};
+	class DivideByZero : public std::domain_error {
+	public:
+		DivideByZero();
+	};
 	bool isMinus = false;
-	size_t length;
-	int *data = nullptr;
+	size_t length = 1;
 	size_t capacity = MIN_CAPACITY;
-	void _DoubleSpace();
-	void _SafeNewSpace(int *&p, const size_t &len);
+	Kernel::Limb *data = local;
+	Kernel::Limb local[MIN_CAPACITY] = {};
+	void _SafeNewSpace(const size_t &len);
+	void _Release();
+	void _Reserve(const size_t &len);
+	void _Trim();
+	void _SetMagnitude(unsigned long long x);
 	explicit Bint(const size_t &capa);
+	static Bint _AddAbs(const Bint &lhs, const Bint &rhs, const bool &minus);
+	static Bint _SubAbs(const Bint &lhs, const Bint &rhs, const bool &minus);
+	static void _DivMod(const Bint &lhs, const Bint &rhs, Bint *quotient, Bint *remainder);
 public:
 	Bint();
 	Bint(int x);
@@ -53,6 +90,13 @@ public:
 	friend Bint operator-(Bint &&b);
 	friend Bint operator-(const Bint &lhs, const Bint &rhs);
 	friend Bint operator*(const Bint &lhs, const Bint &rhs);
+	friend Bint operator/(const Bint &lhs, const Bint &rhs);
+	friend Bint operator%(const Bint &lhs, const Bint &rhs);
+	friend std::pair<Bint, Bint> divmod(const Bint &lhs, const Bint &rhs);
+	friend Bint operator/(const Bint &lhs, long long rhs);
+	friend long long operator%(const Bint &lhs, long long rhs);
+	friend std::pair<Bint, long long> divmod(const Bint &lhs, long long rhs);
+	friend Bint divexact(const Bint &lhs, const Bint &rhs);
 
 	friend std::istream &operator>>(std::istream &is, Bint &b);
 	friend std::ostream &operator<<(std::ostream &os, const Bint &b);
@@ -66,163 +110,1270 @@ public:
 
 namespace Util {
 
-Bint::NewSpaceFailed::NewSpaceFailed() : std::runtime_error("No Enough Memory Space.") {}
-Bint::BadCast::BadCast() : std::invalid_argument("Cannot convert to a Bint object") {}
+namespace Kernel {
+
+/**
+ * The largest power of ten in a limb, the base of the decimal conversions.
+ */
+const Limb DECIMAL_BASE = 10000000000000000000ULL;
+const size_t DECIMAL_DIGITS = 19;
+
+/**
+ * Limbs of the shorter factor from which Karatsuba and Toom-3 take over from the schoolbook
+ * multiplication, and the same for squares, whose basecase does half the products.
+ */
+const size_t KARATSUBA_THRESHOLD = 24;
+const size_t TOOM3_THRESHOLD = 768;
+const size_t SQR_KARATSUBA_THRESHOLD = 64;
+const size_t SQR_TOOM3_THRESHOLD = 1024;
+
+/**
+ * Limbs of the shorter factor, and of a square, from which the number theoretic transform
+ * multiplication takes over.
+ */
+const size_t NTT_THRESHOLD = 5000;
+const size_t SQR_NTT_THRESHOLD = 5000;
+
+/**
+ * Limbs of the divisor, and of the quotient, from which division recurses on halves of the
+ * divisor instead of taking a limb of the quotient at a time.
+ */
+const size_t BURNIKEL_ZIEGLER_THRESHOLD = 40;
 
-void Bint::_SafeNewSpace(int *&p, const size_t &len)
+/**
+ * 19-digit chunks of a decimal number, and limbs of a number to print, from which the conversions
+ * split the number by a power of 10^19 and convert the parts apart instead of taking a chunk or
+ * a limb at a time.
+ */
+const size_t DECIMAL_PARSE_THRESHOLD = 384;
+const size_t DECIMAL_PRINT_THRESHOLD = 32;
+
+/**
+ * -1, 0 or 1 as a[0..n) is less than, equal to or greater than b[0..n).
+ */
+int LimbCompare(const Limb *a, const Limb *b, const size_t &n)
 {
-	if (p != nullptr) {
-		delete[] p;
-		p = nullptr;
+	for (size_t i = n; i-- > 0;) {
+		if (a[i] != b[i]) {
+			return a[i] < b[i] ? -1 : 1;
+		}
 	}
-	p = new int[len];
-	if (p == nullptr) {
-		throw NewSpaceFailed();
+	return 0;
+}
+
+/**
+ * r[0..na) = a[0..na) + b[0..nb), na >= nb, returns the carry out. r may be a.
+ */
+Limb LimbAdd(Limb *r, const Limb *a, const size_t &na, const Limb *b, const size_t &nb)
+{
+	Limb carry = 0;
+	size_t i = 0;
+	for (; i < nb; ++i) {
+		const WideLimb t = WideLimb(a[i]) + b[i] + carry;
+		r[i] = static_cast<Limb>(t);
+		carry = static_cast<Limb>(t >> 64);
+	}
+	for (; i < na; ++i) {
+		const Limb t = a[i] + carry;
+		carry = t < carry;
+		r[i] = t;
 	}
-	memset(p, 0, len * sizeof(unsigned int));
+	return carry;
 }
 
-void Bint::_DoubleSpace()
+/**
+ * r[0..na) = a[0..na) - b[0..nb), na >= nb, returns the borrow out. r may be a.
+ */
+Limb LimbSub(Limb *r, const Limb *a, const size_t &na, const Limb *b, const size_t &nb)
 {
-	int *newMem = nullptr;
-	_SafeNewSpace(newMem, capacity << 1);
-	memcpy(newMem, data, capacity * sizeof(int));
-	delete[] data;
-	data = newMem;
-	capacity <<= 1;
+	Limb borrow = 0;
+	size_t i = 0;
+	for (; i < nb; ++i) {
+		const WideLimb t = WideLimb(a[i]) - b[i] - borrow;
+		r[i] = static_cast<Limb>(t);
+		borrow = static_cast<Limb>(t >> 64) & 1;
+	}
+	for (; i < na; ++i) {
+		const Limb t = a[i] - borrow;
+		borrow = a[i] < borrow;
+		r[i] = t;
+	}
+	return borrow;
 }
 
-Bint::Bint()
-	: length(1)
+/**
+ * r[0..n) = a[0..n) * m + carry, returns the limb carried out. r may be a.
+ */
+Limb LimbMul1(Limb *r, const Limb *a, const size_t &n, const Limb &m, Limb carry)
 {
-	_SafeNewSpace(data, capacity);
+	for (size_t i = 0; i < n; ++i) {
+		const WideLimb t = WideLimb(a[i]) * m + carry;
+		r[i] = static_cast<Limb>(t);
+		carry = static_cast<Limb>(t >> 64);
+	}
+	return carry;
 }
 
-Bint::Bint(int x)
-	: length(0)
+/**
+ * r[0..n) += a[0..n) * m, returns the limb carried out.
+ */
+Limb LimbAddMul1(Limb *r, const Limb *a, const size_t &n, const Limb &m)
+{
+	Limb carry = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const WideLimb t = WideLimb(a[i]) * m + r[i] + carry;
+		r[i] = static_cast<Limb>(t);
+		carry = static_cast<Limb>(t >> 64);
+	}
+	return carry;
+}
+
+/**
+ * r[0..n) -= a[0..n) * m, returns the limb borrowed out.
+ */
+Limb LimbSubMul1(Limb *r, const Limb *a, const size_t &n, const Limb &m)
 {
-	_SafeNewSpace(data, capacity);
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
+	Limb borrow = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const WideLimb t = WideLimb(a[i]) * m + borrow;
+		const Limb low = static_cast<Limb>(t);
+		borrow = static_cast<Limb>(t >> 64) + (r[i] < low);
+		r[i] -= low;
 	}
-	while (x) {
-		data[length++] = x % 10000;
-		x /= 10000;
+	return borrow;
+}
+
+/**
+ * r[0..n) = a[0..n) << s, 0 <= s < 64, returns the bits shifted out. r may be a.
+ */
+Limb LimbShiftLeft(Limb *r, const Limb *a, const size_t &n, const unsigned &s)
+{
+	if (!s) {
+		memmove(r, a, sizeof(Limb) * n);
+		return 0;
 	}
-	if (!length) {
-		length = 1;
+	const Limb out = a[n - 1] >> (64 - s);
+	for (size_t i = n - 1; i > 0; --i) {
+		r[i] = (a[i] << s) | (a[i - 1] >> (64 - s));
 	}
+	r[0] = a[0] << s;
+	return out;
 }
 
-Bint::Bint(long long x)
-	: length(0)
+/**
+ * r[0..n) = a[0..n) >> s, 0 <= s < 64. r may be a.
+ */
+void LimbShiftRight(Limb *r, const Limb *a, const size_t &n, const unsigned &s)
 {
-	_SafeNewSpace(data, capacity);
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
+	if (!s) {
+		memmove(r, a, sizeof(Limb) * n);
+		return;
 	}
-	while (x) {
-		data[length++] = static_cast<unsigned int>(x % 10000);
-		x /= 10000;
+	for (size_t i = 0; i + 1 < n; ++i) {
+		r[i] = (a[i] >> s) | (a[i + 1] << (64 - s));
+	}
+	r[n - 1] = a[n - 1] >> s;
+}
+
+LimbDivisor::LimbDivisor(const Limb &divisor)
+	: shift(static_cast<unsigned>(__builtin_clzll(divisor)))
+{
+	d = divisor << shift;
+	inv = static_cast<Limb>(((WideLimb(~d) << 64) | ~Limb(0)) / d);
+}
+
+/**
+ * The quotient of (u1 2^64 + u0) / d for u1 < d with the divisor's inverse, the remainder in r
+ * (Moller and Granlund, Improved division by invariant integers).
+ */
+Limb _LimbDivStep(const Limb &u1, const Limb &u0, const LimbDivisor &div, Limb &r)
+{
+	const WideLimb q = WideLimb(div.inv) * u1 + ((WideLimb(u1 + 1) << 64) | u0);
+	Limb q1 = static_cast<Limb>(q >> 64);
+	r = u0 - q1 * div.d;
+	if (r > static_cast<Limb>(q)) {
+		--q1;
+		r += div.d;
 	}
-	if (!length) {
-		length = 1;
+	if (r >= div.d) {
+		++q1;
+		r -= div.d;
 	}
+	return q1;
 }
 
-Bint::Bint(const size_t &capa)
-	: length(1)
+/**
+ * q[0..n) = a[0..n) / d, returns a mod d. q may be a.
+ */
+Limb LimbDiv1(Limb *q, const Limb *a, const size_t &n, const LimbDivisor &div)
 {
-	while (capacity < capa) {
-		capacity <<= 1;
+	if (!n) {
+		return 0;
+	}
+	const unsigned s = div.shift;
+	// the dividend is shifted with the divisor, a limb at a time
+	Limb r = s ? a[n - 1] >> (64 - s) : 0;
+	for (size_t i = n; i-- > 0;) {
+		const Limb u = s ? (a[i] << s) | (i ? a[i - 1] >> (64 - s) : 0) : a[i];
+		const Limb high = r;
+		q[i] = _LimbDivStep(high, u, div, r);
 	}
-	_SafeNewSpace(data, capacity);
+	return r >> s;
 }
 
-Bint::Bint(std::string x)
+/**
+ * a[0..n) mod d, LimbDiv1 without the quotient.
+ */
+Limb LimbMod1(const Limb *a, const size_t &n, const LimbDivisor &div)
 {
-	while (x[0] == '-') {
-		isMinus = !isMinus;
-		x.erase(0, 1);
+	if (!n) {
+		return 0;
 	}
-	while ((capacity << 2) <= x.length()) {
-		capacity <<= 1;
+	const unsigned s = div.shift;
+	Limb r = s ? a[n - 1] >> (64 - s) : 0;
+	for (size_t i = n; i-- > 0;) {
+		const Limb u = s ? (a[i] << s) | (i ? a[i - 1] >> (64 - s) : 0) : a[i];
+		const Limb high = r;
+		_LimbDivStep(high, u, div, r);
 	}
+	return r >> s;
+}
 
-	_SafeNewSpace(data, capacity);
+/**
+ * The inverse of an odd d modulo 2^64 by Newton's iteration, each step doubles the correct low bits.
+ */
+Limb _LimbInverse(const Limb &d)
+{
+	Limb x = d;
+	for (int i = 0; i < 5; ++i) {
+		x *= 2 - d * x;
+	}
+	return x;
+}
 
-	size_t mid = x.length() >> 1;
-	for (size_t i = 0; i < mid; ++i) {
-		std::swap(x[i], x[x.length() - 1 - i]);
+/**
+ * q[0..n) = a[0..n) / d for a multiple a of d != 0, from the low limb up with the inverse of the
+ * odd part of d (Jebelean, An algorithm for exact division): no quotient estimation is needed.
+ * q may be a.
+ */
+void LimbDivExact1(Limb *q, const Limb *a, const size_t &n, const Limb &d)
+{
+	const unsigned t = static_cast<unsigned>(__builtin_ctzll(d));
+	const Limb odd = d >> t, inverse = _LimbInverse(odd);
+	Limb borrow = 0;
+	for (size_t i = 0; i < n; ++i) {
+		// the odd part divides a / 2^t, shifted in a limb at a time
+		const Limb x = t ? (a[i] >> t) | (i + 1 < n ? a[i + 1] << (64 - t) : 0) : a[i];
+		const Limb under = x < borrow;
+		const Limb y = (x - borrow) * inverse;
+		q[i] = y;
+		borrow = static_cast<Limb>((WideLimb(y) * odd) >> 64) + under;
+	}
+}
+
+/**
+ * r[0..na + nb) = a[0..na) * b[0..nb), row by row, na and nb > 0. r must not overlap a or b.
+ */
+void _LimbMulBasecase(Limb *r, const Limb *a, const size_t &na, const Limb *b, const size_t &nb)
+{
+	r[na] = LimbMul1(r, a, na, b[0], 0);
+	for (size_t j = 1; j < nb; ++j) {
+		r[na + j] = LimbAddMul1(r + j, a, na, b[j]);
 	}
+}
 
-	const static unsigned int pow10[4] = {1, 10, 100, 1000};
-	for (size_t i = 0; i < capacity; ++i) {
-		if ((i << 2) >= x.length()) {
-			length = i;
-			break;
+/**
+ * r[0..2n) = a[0..n)^2: the products a[i] a[j], i < j, once, doubled, then the squares a[i]^2 added.
+ */
+void _LimbSqrBasecase(Limb *r, const Limb *a, const size_t &len)
+{
+	// a copy the compiler need not reload after every store to r
+	const size_t n = len;
+	r[0] = 0;
+	r[n] = LimbMul1(r + 1, a + 1, n - 1, a[0], 0);
+	for (size_t i = 1; i < n; ++i) {
+		r[n + i] = LimbAddMul1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+	}
+	Limb high = 0;
+	for (size_t i = 0; i < 2 * n; ++i) {
+		const Limb next = r[i] >> 63;
+		r[i] = (r[i] << 1) | high;
+		high = next;
+	}
+	Limb carry = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const WideLimb sq = WideLimb(a[i]) * a[i];
+		WideLimb t = WideLimb(r[2 * i]) + static_cast<Limb>(sq) + carry;
+		r[2 * i] = static_cast<Limb>(t);
+		t = WideLimb(r[2 * i + 1]) + static_cast<Limb>(sq >> 64) + static_cast<Limb>(t >> 64);
+		r[2 * i + 1] = static_cast<Limb>(t);
+		carry = static_cast<Limb>(t >> 64);
+	}
+}
+
+/**
+ * r[0..na) = |a[0..na) - b[0..nb)|, na >= nb, returns whether a < b.
+ */
+bool _LimbAbsDiff(Limb *r, const Limb *a, const size_t &na, const Limb *b, const size_t &nb)
+{
+	size_t top = na;
+	while (top > nb && a[top - 1] == 0) {
+		--top;
+	}
+	if (top == nb && LimbCompare(a, b, nb) < 0) {
+		LimbSub(r, b, nb, a, nb);
+		std::fill(r + nb, r + na, 0);
+		return true;
+	}
+	LimbSub(r, a, na, b, nb);
+	return false;
+}
+
+/**
+ * Limbs of scratch space enough for any product of na + nb limbs below Toom-3.
+ */
+size_t _LimbMulScratch(const size_t &n)
+{
+	return 6 * n + 640;
+}
+
+void _LimbMul(Limb *r, const Limb *a, size_t na, const Limb *b, size_t nb, Limb *ws);
+void _LimbSqr(Limb *r, const Limb *a, const size_t &n, Limb *ws);
+void _LimbMulToom3(Limb *r, const Limb *a, const size_t &na, const Limb *b, const size_t &nb);
+void _LimbMulNtt(Limb *r, const Limb *a, const size_t &na, const Limb *b, const size_t &nb);
+
+/**
+ * a and b split at h = ceil(na / 2), na >= nb > h:
+ * a b = z0 + (z0 + z2 - (a0 - a1)(b0 - b1)) 2^(64 h) + z2 2^(128 h), z0 = a0 b0, z2 = a1 b1.
+ * With the differences in absolute value the middle term never carries past 2h + 1 limbs.
+ */
+void _LimbMulKaratsuba(Limb *r, const Limb *a, const size_t &na, const Limb *b, const size_t &nb, Limb *ws)
+{
+	const size_t h = (na + 1) / 2, la = na - h, lb = nb - h;
+	Limb *da = ws, *db = ws + h, *t = ws + 2 * h, *mid = ws + 4 * h, *next = ws + 6 * h + 1;
+	const bool negative = _LimbAbsDiff(da, a, h, a + h, la) != _LimbAbsDiff(db, b, h, b + h, lb);
+	_LimbMul(r, a, h, b, h, next);
+	_LimbMul(r + 2 * h, a + h, la, b + h, lb, next);
+	_LimbMul(t, da, h, db, h, next);
+	mid[2 * h] = LimbAdd(mid, r, 2 * h, r + 2 * h, la + lb);
+	if (negative) {
+		LimbAdd(mid, mid, 2 * h + 1, t, 2 * h);
+	}
+	else {
+		LimbSub(mid, mid, 2 * h + 1, t, 2 * h);
+	}
+	size_t len = 2 * h + 1;
+	while (len > 0 && mid[len - 1] == 0) {
+		--len;
+	}
+	LimbAdd(r + h, r + h, na + nb - h, mid, len);
+}
+
+/**
+ * Karatsuba for a square: the middle term is z0 + z2 - (a0 - a1)^2, all three are squares.
+ */
+void _LimbSqrKaratsuba(Limb *r, const Limb *a, const size_t &n, Limb *ws)
+{
+	const size_t h = (n + 1) / 2, l = n - h;
+	Limb *d = ws, *t = ws + h, *mid = ws + 3 * h, *next = ws + 5 * h + 1;
+	_LimbAbsDiff(d, a, h, a + h, l);
+	_LimbSqr(r, a, h, next);
+	_LimbSqr(r + 2 * h, a + h, l, next);
+	_LimbSqr(t, d, h, next);
+	mid[2 * h] = LimbAdd(mid, r, 2 * h, r + 2 * h, 2 * l);
+	LimbSub(mid, mid, 2 * h + 1, t, 2 * h);
+	size_t len = 2 * h + 1;
+	while (len > 0 && mid[len - 1] == 0) {
+		--len;
+	}
+	LimbAdd(r + h, r + h, 2 * n - h, mid, len);
+}
+
+/**
+ * nb <= ceil(na / 2): a is cut into pieces of nb limbs, each piece times b is added in at its place.
+ */
+void _LimbMulUnbalanced(Limb *r, const Limb *a, const size_t &na, const Limb *b, const size_t &nb, Limb *ws)
+{
+	Limb *t = ws, *next = ws + 2 * nb;
+	_LimbMul(r, a, nb, b, nb, next);
+	for (size_t i = nb; i < na; i += nb) {
+		const size_t len = std::min(nb, na - i);
+		_LimbMul(t, a + i, len, b, nb, next);
+		// r[i..i + nb) holds the top of the pieces before
+		memcpy(r + i + nb, t + nb, sizeof(Limb) * len);
+		LimbAdd(r + i, r + i, len + nb, t, nb);
+	}
+}
+
+/**
+ * r[0..na + nb) = a * b with a working space of _LimbMulScratch(na + nb) limbs.
+ */
+void _LimbMul(Limb *r, const Limb *a, size_t na, const Limb *b, size_t nb, Limb *ws)
+{
+	if (na < nb) {
+		std::swap(a, b);
+		std::swap(na, nb);
+	}
+	if (nb < KARATSUBA_THRESHOLD) {
+		_LimbMulBasecase(r, a, na, b, nb);
+	}
+	else if (nb <= (na + 1) / 2) {
+		_LimbMulUnbalanced(r, a, na, b, nb, ws);
+	}
+	else if (nb >= TOOM3_THRESHOLD && nb > 2 * ((na + 2) / 3)) {
+		_LimbMulToom3(r, a, na, b, nb);
+	}
+	else {
+		_LimbMulKaratsuba(r, a, na, b, nb, ws);
+	}
+}
+
+void _LimbSqr(Limb *r, const Limb *a, const size_t &n, Limb *ws)
+{
+	if (n < SQR_KARATSUBA_THRESHOLD) {
+		_LimbSqrBasecase(r, a, n);
+	}
+	else if (n >= SQR_TOOM3_THRESHOLD) {
+		_LimbMulToom3(r, a, n, a, n);
+	}
+	else {
+		_LimbSqrKaratsuba(r, a, n, ws);
+	}
+}
+
+/**
+ * r[0..na + nb) = a[0..na) * b[0..nb), na and nb > 0. r must not overlap a or b.
+ * Schoolbook below KARATSUBA_THRESHOLD limbs, then Karatsuba, Toom-3 from TOOM3_THRESHOLD and
+ * transforms from NTT_THRESHOLD; below that a factor more than twice as long as the other is
+ * multiplied piece by piece.
+ */
+void LimbMul(Limb *r, const Limb *a, const size_t &na, const Limb *b, const size_t &nb)
+{
+	if (std::min(na, nb) >= NTT_THRESHOLD) {
+		_LimbMulNtt(r, a, na, b, nb);
+		return;
+	}
+	if (std::min(na, nb) < KARATSUBA_THRESHOLD) {
+		if (na >= nb) {
+			_LimbMulBasecase(r, a, na, b, nb);
 		}
-		for (size_t j = 0; j < 4; ++j) {
-			if ((i << 2) + j >= x.length()) {
-				break;
+		else {
+			_LimbMulBasecase(r, b, nb, a, na);
+		}
+		return;
+	}
+	std::vector<Limb> ws(_LimbMulScratch(na + nb));
+	_LimbMul(r, a, na, b, nb, ws.data());
+}
+
+/**
+ * r[0..2n) = a[0..n)^2, n > 0, about half the work of LimbMul(r, a, n, a, n).
+ */
+void LimbSqr(Limb *r, const Limb *a, const size_t &n)
+{
+	if (n >= SQR_NTT_THRESHOLD) {
+		_LimbMulNtt(r, a, n, a, n);
+		return;
+	}
+	if (n < SQR_KARATSUBA_THRESHOLD) {
+		_LimbSqrBasecase(r, a, n);
+		return;
+	}
+	std::vector<Limb> ws(_LimbMulScratch(2 * n));
+	_LimbSqr(r, a, n, ws.data());
+}
+
+/**
+ * A signed number for the evaluation and interpolation of Toom-3, zero has no limbs.
+ */
+struct _ToomValue {
+	std::vector<Limb> mag;
+	bool neg = false;
+};
+
+void _ToomTrim(_ToomValue &v)
+{
+	while (!v.mag.empty() && v.mag.back() == 0) {
+		v.mag.pop_back();
+	}
+	if (v.mag.empty()) {
+		v.neg = false;
+	}
+}
+
+_ToomValue _ToomFrom(const Limb *a, const size_t &n)
+{
+	_ToomValue v;
+	v.mag.assign(a, a + n);
+	_ToomTrim(v);
+	return v;
+}
+
+/**
+ * a + b, or a - b when subtract is set.
+ */
+_ToomValue _ToomAdd(const _ToomValue &a, const _ToomValue &b, const bool &subtract = false)
+{
+	const bool bneg = b.neg != subtract;
+	_ToomValue r;
+	if (a.neg == bneg) {
+		const _ToomValue &x = a.mag.size() >= b.mag.size() ? a : b, &y = a.mag.size() >= b.mag.size() ? b : a;
+		r.mag.resize(x.mag.size() + 1);
+		r.mag.back() = LimbAdd(r.mag.data(), x.mag.data(), x.mag.size(), y.mag.data(), y.mag.size());
+		r.neg = a.neg;
+	}
+	else {
+		const int cmp = a.mag.size() != b.mag.size() ? (a.mag.size() < b.mag.size() ? -1 : 1)
+			: LimbCompare(a.mag.data(), b.mag.data(), a.mag.size());
+		const _ToomValue &x = cmp >= 0 ? a : b, &y = cmp >= 0 ? b : a;
+		r.mag.resize(x.mag.size());
+		LimbSub(r.mag.data(), x.mag.data(), x.mag.size(), y.mag.data(), y.mag.size());
+		r.neg = cmp >= 0 ? a.neg : bneg;
+	}
+	_ToomTrim(r);
+	return r;
+}
+
+_ToomValue _ToomTwice(const _ToomValue &a)
+{
+	_ToomValue r = a;
+	r.mag.push_back(0);
+	for (size_t i = r.mag.size() - 1; i > 0; --i) {
+		r.mag[i] = (r.mag[i] << 1) | (r.mag[i - 1] >> 63);
+	}
+	r.mag[0] <<= 1;
+	_ToomTrim(r);
+	return r;
+}
+
+/**
+ * a / 2 for an even a.
+ */
+_ToomValue _ToomHalf(const _ToomValue &a)
+{
+	_ToomValue r = a;
+	for (size_t i = 0; i < r.mag.size(); ++i) {
+		r.mag[i] = (r.mag[i] >> 1) | (i + 1 < r.mag.size() ? r.mag[i + 1] << 63 : 0);
+	}
+	_ToomTrim(r);
+	return r;
+}
+
+/**
+ * a / 3 for a multiple a of 3.
+ */
+_ToomValue _ToomThird(const _ToomValue &a)
+{
+	_ToomValue r = a;
+	LimbDivExact1(r.mag.data(), r.mag.data(), r.mag.size(), 3);
+	_ToomTrim(r);
+	return r;
+}
+
+_ToomValue _ToomMul(const _ToomValue &a, const _ToomValue &b, const bool &square)
+{
+	_ToomValue r;
+	if (a.mag.empty() || b.mag.empty()) {
+		return r;
+	}
+	r.mag.resize(a.mag.size() + b.mag.size());
+	if (square) {
+		LimbSqr(r.mag.data(), a.mag.data(), a.mag.size());
+	}
+	else {
+		LimbMul(r.mag.data(), a.mag.data(), a.mag.size(), b.mag.data(), b.mag.size());
+	}
+	r.neg = a.neg != b.neg;
+	_ToomTrim(r);
+	return r;
+}
+
+/**
+ * a and b as polynomials of degree 2 in x = 2^(64 k), k = ceil(na / 3), nb > 2k, evaluated at
+ * 0, 1, -1, -2 and infinity; the five products are interpolated back (Bodrato's sequence).
+ * a == b is a square, its five products are squares.
+ */
+void _LimbMulToom3(Limb *r, const Limb *a, const size_t &na, const Limb *b, const size_t &nb)
+{
+	const bool square = a == b && na == nb;
+	const size_t k = (na + 2) / 3;
+	const _ToomValue a0 = _ToomFrom(a, k), a1 = _ToomFrom(a + k, k), a2 = _ToomFrom(a + 2 * k, na - 2 * k);
+	const _ToomValue b0 = _ToomFrom(b, k), b1 = _ToomFrom(b + k, k), b2 = _ToomFrom(b + 2 * k, nb - 2 * k);
+	_ToomValue p1 = _ToomAdd(a0, a2), q1 = _ToomAdd(b0, b2);
+	const _ToomValue pm1 = _ToomAdd(p1, a1, true), qm1 = _ToomAdd(q1, b1, true);
+	p1 = _ToomAdd(p1, a1);
+	q1 = _ToomAdd(q1, b1);
+	const _ToomValue pm2 = _ToomAdd(_ToomTwice(_ToomAdd(pm1, a2)), a0, true);
+	const _ToomValue qm2 = _ToomAdd(_ToomTwice(_ToomAdd(qm1, b2)), b0, true);
+	const _ToomValue r0 = _ToomMul(a0, b0, square), rinf = _ToomMul(a2, b2, square);
+	_ToomValue r1 = _ToomMul(p1, q1, square);
+	const _ToomValue rm1 = _ToomMul(pm1, qm1, square), rm2 = _ToomMul(pm2, qm2, square);
+	_ToomValue r3 = _ToomThird(_ToomAdd(rm2, r1, true));
+	r1 = _ToomHalf(_ToomAdd(r1, rm1, true));
+	_ToomValue r2 = _ToomAdd(rm1, r0, true);
+	r3 = _ToomAdd(_ToomHalf(_ToomAdd(r2, r3, true)), _ToomTwice(rinf));
+	r2 = _ToomAdd(_ToomAdd(r2, r1), rinf, true);
+	r1 = _ToomAdd(r1, r3, true);
+	const size_t n = na + nb;
+	std::fill(r, r + n, 0);
+	const _ToomValue *coef[5] = {&r0, &r1, &r2, &r3, &rinf};
+	for (size_t i = 0; i < 5; ++i) {
+		// the coefficients of a product of polynomials with non-negative coefficients are non-negative
+		const std::vector<Limb> &c = coef[i]->mag;
+		if (!c.empty()) {
+			LimbAdd(r + i * k, r + i * k, n - i * k, c.data(), c.size());
+		}
+	}
+}
+
+/**
+ * Arithmetic modulo an odd prime p < 2^63 in Montgomery form, x stored as x 2^64 mod p.
+ */
+struct _NttField {
+	Limb p, inv, r2;
+	explicit _NttField(const Limb &prime);
+	Limb Reduce(const WideLimb &t) const;
+	Limb Mul(const Limb &a, const Limb &b) const;
+	Limb Add(const Limb &a, const Limb &b) const;
+	Limb Sub(const Limb &a, const Limb &b) const;
+	Limb Pow(Limb a, Limb e) const;
+	Limb To(const Limb &x) const;
+};
+
+/**
+ * inv = -p^-1 mod 2^64, r2 = 2^128 mod p turns a number into Montgomery form.
+ */
+_NttField::_NttField(const Limb &prime)
+	: p(prime), inv(0 - _LimbInverse(prime))
+{
+	const Limb r = (0 - p) % p;
+	r2 = static_cast<Limb>(WideLimb(r) * r % p);
+}
+
+/**
+ * t 2^-64 mod p for t < p 2^64.
+ */
+Limb _NttField::Reduce(const WideLimb &t) const
+{
+	const Limb m = static_cast<Limb>(t) * inv;
+	// t + m p < 2^128 as p < 2^63, and its low limb is 0
+	const Limb high = static_cast<Limb>(t >> 64), carry = static_cast<Limb>(t) != 0;
+	const Limb x = high + static_cast<Limb>((WideLimb(m) * p) >> 64) + carry;
+	return x >= p ? x - p : x;
+}
+
+Limb _NttField::Mul(const Limb &a, const Limb &b) const
+{
+	return Reduce(WideLimb(a) * b);
+}
+
+Limb _NttField::Add(const Limb &a, const Limb &b) const
+{
+	const Limb x = a + b;
+	return x >= p ? x - p : x;
+}
+
+Limb _NttField::Sub(const Limb &a, const Limb &b) const
+{
+	// a mask rather than a branch, the comparison is as good as random
+	return a - b + (p & (0 - static_cast<Limb>(a < b)));
+}
+
+/**
+ * a^e for a in Montgomery form, the result in Montgomery form.
+ */
+Limb _NttField::Pow(Limb a, Limb e) const
+{
+	Limb x = To(1);
+	for (; e; e >>= 1) {
+		if (e & 1) {
+			x = Mul(x, a);
+		}
+		a = Mul(a, a);
+	}
+	return x;
+}
+
+/**
+ * x 2^64 mod p for any x < 2^64.
+ */
+Limb _NttField::To(const Limb &x) const
+{
+	return Reduce(WideLimb(x) * r2);
+}
+
+/**
+ * The three primes c 2^k + 1 of the transforms, k >= 55, and a primitive root of each.
+ * Their product is above 2^187, more than any coefficient n (2^64 - 1)^2 of a product of n limbs.
+ */
+const Limb NTT_PRIMES[3] = {4719772409484279809ULL, 6269010681299730433ULL, 7097673012735901697ULL};
+const Limb NTT_ROOTS[3] = {3, 5, 3};
+
+/**
+ * w[len + k] = z^k for the primitive (2 len)-th root of unity z, or its inverse, len = 1, 2, .. n / 2.
+ */
+std::vector<Limb> _NttTwiddles(const _NttField &f, const Limb &root, const size_t &n, const bool &inverse)
+{
+	std::vector<Limb> w(n);
+	for (size_t len = 1; len < n; len <<= 1) {
+		Limb z = f.Pow(f.To(root), (f.p - 1) / (2 * len));
+		if (inverse) {
+			z = f.Pow(z, f.p - 2);
+		}
+		Limb x = f.To(1);
+		for (size_t k = 0; k < len; ++k) {
+			w[len + k] = x;
+			x = f.Mul(x, z);
+		}
+	}
+	return w;
+}
+
+/**
+ * The transform of a[0..n) by decimation in frequency, its output in bit-reversed order.
+ */
+void _NttForward(Limb *a, const size_t &n, const Limb *w, const _NttField &field)
+{
+	// a copy of the field that the stores to a cannot change
+	const _NttField f = field;
+	for (size_t len = n >> 1; len > 0; len >>= 1) {
+		for (size_t i = 0; i < n; i += 2 * len) {
+			for (size_t k = 0; k < len; ++k) {
+				const Limb u = a[i + k], v = a[i + k + len];
+				a[i + k] = f.Add(u, v);
+				a[i + k + len] = f.Mul(f.Sub(u, v), w[len + k]);
 			}
-			if (x[(i << 2) + j] > '9' || x[(i << 2) + j] < '0') {
-				throw BadCast();
+		}
+	}
+}
+
+/**
+ * The inverse of _NttForward up to a factor n by decimation in time, w the inverse twiddles:
+ * bit-reversed input, output in order.
+ */
+void _NttInverse(Limb *a, const size_t &n, const Limb *w, const _NttField &field)
+{
+	// a copy of the field that the stores to a cannot change
+	const _NttField f = field;
+	for (size_t len = 1; len < n; len <<= 1) {
+		for (size_t i = 0; i < n; i += 2 * len) {
+			for (size_t k = 0; k < len; ++k) {
+				const Limb u = a[i + k], v = f.Mul(a[i + k + len], w[len + k]);
+				a[i + k] = f.Add(u, v);
+				a[i + k + len] = f.Sub(u, v);
 			}
-			data[i] = data[i] + (x[(i << 2) + j] - '0') * pow10[j];
 		}
 	}
 }
 
-Bint::Bint(const Bint &b)
-	: isMinus(b.isMinus), length(b.length), capacity(b.capacity)
+/**
+ * c[0..n) = the coefficients of a * b modulo the prime, n >= na + nb a power of two.
+ * a == b transforms once.
+ */
+void _NttConvolve(std::vector<Limb> &c, const Limb *a, const size_t &na, const Limb *b, const size_t &nb,
+	const size_t &n, const size_t &prime)
 {
-	_SafeNewSpace(data, capacity);
-	memcpy(data, b.data, sizeof(unsigned int) * capacity);
+	const _NttField f(NTT_PRIMES[prime]);
+	const bool square = a == b && na == nb;
+	c.assign(n, 0);
+	for (size_t i = 0; i < na; ++i) {
+		c[i] = f.To(a[i]);
+	}
+	const std::vector<Limb> w = _NttTwiddles(f, NTT_ROOTS[prime], n, false);
+	_NttForward(c.data(), n, w.data(), f);
+	if (square) {
+		for (size_t i = 0; i < n; ++i) {
+			c[i] = f.Mul(c[i], c[i]);
+		}
+	}
+	else {
+		std::vector<Limb> d(n, 0);
+		for (size_t i = 0; i < nb; ++i) {
+			d[i] = f.To(b[i]);
+		}
+		_NttForward(d.data(), n, w.data(), f);
+		for (size_t i = 0; i < n; ++i) {
+			c[i] = f.Mul(c[i], d[i]);
+		}
+	}
+	const std::vector<Limb> wi = _NttTwiddles(f, NTT_ROOTS[prime], n, true);
+	_NttInverse(c.data(), n, wi.data(), f);
+	// 1 / n, then out of Montgomery form: a reduction of c n^-1 2^64 leaves c n^-1
+	const Limb scale = f.Pow(f.To(n), f.p - 2);
+	for (size_t i = 0; i < n; ++i) {
+		c[i] = f.Reduce(f.Mul(c[i], scale));
+	}
 }
 
-Bint::Bint(Bint &&b) noexcept
-	: isMinus(b.isMinus), length(b.length), capacity(b.capacity)
+/**
+ * r[0..na + nb) = a * b by three number theoretic transforms, the coefficients put together
+ * by the Chinese remainder theorem (Garner's form) and carried into limbs.
+ */
+void _LimbMulNtt(Limb *r, const Limb *a, const size_t &na, const Limb *b, const size_t &nb)
 {
-	data = b.data;
-	b.data = nullptr;
+	size_t n = 1;
+	while (n < na + nb) {
+		n <<= 1;
+	}
+	std::vector<Limb> c[3];
+	for (size_t i = 0; i < 3; ++i) {
+		_NttConvolve(c[i], a, na, b, nb, n, i);
+	}
+	const Limb p1 = NTT_PRIMES[0], p2 = NTT_PRIMES[1];
+	const _NttField f2(p2), f3(NTT_PRIMES[2]);
+	// Montgomery forms of 1 / p1 mod p2, 1 / p1 mod p3 and 1 / p2 mod p3
+	const Limb inv12 = f2.Pow(f2.To(p1), p2 - 2);
+	const Limb inv13 = f3.Pow(f3.To(p1), f3.p - 2), inv23 = f3.Pow(f3.To(p2), f3.p - 2);
+	const WideLimb p12 = WideLimb(p1) * p2;
+	// the carry into the next coefficient stays below 2^128
+	WideLimb carry = 0;
+	for (size_t i = 0; i < na + nb; ++i) {
+		// x = x1 + p1 x2 + p1 p2 x3 with x1 < p1, x2 < p2, x3 < p3
+		const Limb x1 = c[0][i];
+		const Limb x2 = f2.Mul(f2.Sub(c[1][i], x1), inv12);
+		const Limb x3 = f3.Mul(f3.Sub(f3.Mul(f3.Sub(c[2][i], x1), inv13), x2), inv23);
+		const WideLimb low = WideLimb(p1) * x2 + x1;
+		const WideLimb t0 = WideLimb(static_cast<Limb>(p12)) * x3;
+		const WideLimb t1 = WideLimb(static_cast<Limb>(p12 >> 64)) * x3 + (t0 >> 64);
+		// x + carry = s0 + s1 2^64 + s2 2^128
+		WideLimb s = WideLimb(static_cast<Limb>(t0)) + static_cast<Limb>(low) + static_cast<Limb>(carry);
+		r[i] = static_cast<Limb>(s);
+		s = (s >> 64) + static_cast<Limb>(t1) + static_cast<Limb>(low >> 64) + static_cast<Limb>(carry >> 64);
+		carry = s + ((t1 >> 64) << 64);
+	}
 }
 
-Bint &Bint::operator=(int x)
+/**
+ * Knuth's algorithm D for a normalized d[0..nd), nd >= 2, its top bit set, and u[0..nu) whose top
+ * nd limbs are less than d: q[0..nu - nd) = u / d, the remainder is left in u[0..nd), zeros above.
+ */
+void _LimbDivNorm(Limb *q, Limb *u, const size_t &nu, const Limb *d, const size_t &nd)
+{
+	const Limb d1 = d[nd - 1], d0 = d[nd - 2];
+	const LimbDivisor div(d1);
+	for (size_t j = nu - nd; j-- > 0;) {
+		const Limb u2 = u[j + nd], u1 = u[j + nd - 1], u0 = u[j + nd - 2];
+		Limb qhat, rhat;
+		bool over = false;
+		if (u2 >= d1) {
+			// u2 == d1: the estimate from the top two limbs is 2^64 - 1
+			qhat = ~Limb(0);
+			rhat = u1 + d1;
+			over = rhat < d1;
+		}
+		else {
+			qhat = _LimbDivStep(u2, u1, div, rhat);
+		}
+		// with the next limb of both the estimate is at most one too large
+		while (!over && WideLimb(qhat) * d0 > ((WideLimb(rhat) << 64) | u0)) {
+			--qhat;
+			rhat += d1;
+			over = rhat < d1;
+		}
+		if (u2 < LimbSubMul1(u + j, d, nd, qhat)) {
+			--qhat;
+			LimbAdd(u + j, u + j, nd, d, nd);
+		}
+		// the remainder fits below u[j + nd], with or without the correction
+		u[j + nd] = 0;
+		q[j] = qhat;
+	}
+}
+
+void _LimbDiv3n2n(Limb *q, Limb *u, const Limb *d, const size_t &h);
+
+/**
+ * u[0..2n) by a normalized d[0..n), u[n..2n) < d: q[0..n) = u / d, the remainder is left in u[0..n),
+ * zeros above (Burnikel and Ziegler, Fast recursive division). Knuth's algorithm D for odd n and
+ * below BURNIKEL_ZIEGLER_THRESHOLD.
+ */
+void _LimbDiv2n1n(Limb *q, Limb *u, const Limb *d, const size_t &n)
 {
-	memset(data, 0, sizeof(unsigned int) * capacity);
-	length = 0;
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
+	if (n < BURNIKEL_ZIEGLER_THRESHOLD || (n & 1)) {
+		_LimbDivNorm(q, u, 2 * n, d, n);
+		return;
 	}
-	while (x) {
-		data[length++] = x % 10000;
-		x /= 10000;
+	const size_t h = n / 2;
+	_LimbDiv3n2n(q + h, u + h, d, h);
+	_LimbDiv3n2n(q, u, d, h);
+}
+
+/**
+ * u[0..3h) by d[0..2h) = d1 2^(64 h) + d0, u[h..3h) < d: q[0..h) = u / d, the remainder in u[0..2h).
+ * The quotient of the top 2h limbs by d1 is at most two too large.
+ */
+void _LimbDiv3n2n(Limb *q, Limb *u, const Limb *d, const size_t &h)
+{
+	const Limb *d1 = d + h;
+	if (LimbCompare(u + 2 * h, d1, h) < 0) {
+		_LimbDiv2n1n(q, u + h, d1, h);
 	}
-	if (!length) {
-		length = 1;
+	else {
+		// u[2h..3h) == d1: q = 2^(64 h) - 1 leaves u[h..2h) + d1
+		std::fill(q, q + h, ~Limb(0));
+		std::fill(u + 2 * h, u + 3 * h, 0);
+		u[2 * h] = LimbAdd(u + h, u + h, h, d1, h);
+	}
+	std::vector<Limb> t(2 * h);
+	LimbMul(t.data(), q, h, d, h);
+	Limb negative = LimbSub(u, u, 3 * h, t.data(), 2 * h);
+	const Limb one = 1;
+	while (negative) {
+		LimbSub(q, q, h, &one, 1);
+		negative -= LimbAdd(u, u, 3 * h, d, 2 * h);
 	}
-	return *this;
 }
 
-Bint &Bint::operator=(long long x)
+/**
+ * q[0..na - nb + 1) = a / b and r[0..nb) = a mod b, na >= nb > 0, b[nb - 1] != 0.
+ * LimbDiv1 for one limb, Knuth's algorithm D, and Burnikel and Ziegler's recursion when both the
+ * divisor and the quotient reach BURNIKEL_ZIEGLER_THRESHOLD limbs, its products by LimbMul.
+ */
+void LimbDivRem(Limb *q, Limb *r, const Limb *a, const size_t &na, const Limb *b, const size_t &nb)
 {
-	memset(data, 0, sizeof(unsigned int) * capacity);
-	length = 0;
-	if (x < 0) {
-		isMinus = true;
-		x = -x;
+	if (nb == 1) {
+		r[0] = LimbDiv1(q, a, na, LimbDivisor(b[0]));
+		return;
 	}
-	while (x) {
-		data[length++] = static_cast<unsigned int>(x % 10000);
-		x /= 10000;
+	const unsigned s = static_cast<unsigned>(__builtin_clzll(b[nb - 1]));
+	if (nb < BURNIKEL_ZIEGLER_THRESHOLD || na - nb < BURNIKEL_ZIEGLER_THRESHOLD) {
+		std::vector<Limb> d(nb), u(na + 1);
+		LimbShiftLeft(d.data(), b, nb, s);
+		// the top limb holds fewer than s bits, so the top nb limbs of u are below d
+		u[na] = LimbShiftLeft(u.data(), a, na, s);
+		_LimbDivNorm(q, u.data(), na + 1, d.data(), nb);
+		LimbShiftRight(r, u.data(), nb, s);
+		return;
 	}
-	if (!length) {
-		length = 1;
+	// b is padded with low zero limbs to n limbs, halving n ends below the threshold,
+	// and a moves with it
+	size_t parts = 1;
+	while (nb / parts >= BURNIKEL_ZIEGLER_THRESHOLD) {
+		parts <<= 1;
 	}
+	const size_t n = (nb + parts - 1) / parts * parts, pad = n - nb, len = na + pad + 1;
+	// the quotient limbs above whole blocks of n come from one pass of Knuth's algorithm,
+	// or, when they are more than half a block, from a block with leading zeros
+	size_t blocks = (len - n) / n;
+	if ((len - n) % n > n / 2) {
+		++blocks;
+	}
+	const size_t top = blocks * n;
+	std::vector<Limb> d(n, 0), u(std::max(len, top + n), 0), quotient(u.size() - n);
+	LimbShiftLeft(d.data() + pad, b, nb, s);
+	// as above, the top n limbs of u are below d
+	u[na + pad] = LimbShiftLeft(u.data() + pad, a, na, s);
+	if (u.size() - top > n) {
+		_LimbDivNorm(quotient.data() + top, u.data() + top, u.size() - top, d.data(), n);
+	}
+	for (size_t i = blocks; i-- > 0;) {
+		_LimbDiv2n1n(quotient.data() + i * n, u.data() + i * n, d.data(), n);
+	}
+	memcpy(q, quotient.data(), sizeof(Limb) * (na - nb + 1));
+	LimbShiftRight(r, u.data() + pad, nb, s);
+}
+
+/**
+ * q[0..na - nb + 1) = a / b for a multiple a of b, na >= nb > 0, b[nb - 1] != 0.
+ * Below BURNIKEL_ZIEGLER_THRESHOLD the quotient comes from the low limbs up, each limb one
+ * multiplication by the inverse of b modulo 2^64, without estimates or corrections.
+ */
+void LimbDivExact(Limb *q, const Limb *a, const size_t &na, const Limb *b, const size_t &nb)
+{
+	const size_t nq = na - nb + 1;
+	if (nb == 1) {
+		LimbDivExact1(q, a, na, b[0]);
+		return;
+	}
+	if (nb >= BURNIKEL_ZIEGLER_THRESHOLD && nq >= BURNIKEL_ZIEGLER_THRESHOLD) {
+		std::vector<Limb> r(nb);
+		LimbDivRem(q, r.data(), a, na, b, nb);
+		return;
+	}
+	// the zero limbs and bits at the bottom of b are at the bottom of a too
+	size_t z = 0;
+	while (b[z] == 0) {
+		++z;
+	}
+	const unsigned s = static_cast<unsigned>(__builtin_ctzll(b[z]));
+	std::vector<Limb> u(na - z), d(nb - z);
+	LimbShiftRight(u.data(), a + z, na - z, s);
+	LimbShiftRight(d.data(), b + z, nb - z, s);
+	const size_t nd = d.size() > 1 && d.back() == 0 ? d.size() - 1 : d.size();
+	const Limb inverse = _LimbInverse(d[0]);
+	for (size_t i = 0; i < nq; ++i) {
+		const Limb x = u[i] * inverse;
+		q[i] = x;
+		Limb borrow = LimbSubMul1(u.data() + i, d.data(), std::min(nd, u.size() - i), x);
+		for (size_t k = i + nd; borrow && k < u.size(); ++k) {
+			const Limb old = u[k];
+			u[k] = old - borrow;
+			borrow = old < borrow;
+		}
+	}
+}
+
+/**
+ * Appends 10^(19 * 2^k) to powers, starting from 10^19, until 2^k reaches chunks.
+ */
+void _DecimalPowers(std::vector<std::vector<Limb>> &powers, const size_t &chunks)
+{
+	if (powers.empty()) {
+		powers.push_back(std::vector<Limb>(1, DECIMAL_BASE));
+	}
+	while ((size_t(1) << powers.size()) < chunks) {
+		std::vector<Limb> square(2 * powers.back().size());
+		LimbSqr(square.data(), powers.back().data(), powers.back().size());
+		while (square.back() == 0) {
+			square.pop_back();
+		}
+		powers.push_back(std::move(square));
+	}
+}
+
+/**
+ * r = the number whose 19-digit chunks, lowest first, are c[0..m), returns its length in limbs,
+ * at most m and 0 for zero. From DECIMAL_PARSE_THRESHOLD chunks on the low 2^k < m chunks and the
+ * rest are converted apart and joined as high * 10^(19 * 2^k) + low.
+ */
+size_t _LimbFromDecimal(Limb *r, const Limb *c, const size_t &m, const std::vector<std::vector<Limb>> &powers)
+{
+	if (m < DECIMAL_PARSE_THRESHOLD) {
+		size_t n = 0;
+		for (size_t i = m; i-- > 0;) {
+			const Limb carry = LimbMul1(r, r, n, DECIMAL_BASE, c[i]);
+			if (carry) {
+				r[n++] = carry;
+			}
+		}
+		return n;
+	}
+	size_t k = 0;
+	while ((size_t(2) << k) < m) {
+		++k;
+	}
+	const size_t h = size_t(1) << k;
+	const std::vector<Limb> &p = powers[k];
+	std::vector<Limb> high(m - h);
+	const size_t nh = _LimbFromDecimal(high.data(), c + h, m - h, powers);
+	const size_t nl = _LimbFromDecimal(r, c, h, powers);
+	if (nh == 0) {
+		return nl;
+	}
+	// low < 10^(19 * 2^k), so it is no longer than p
+	std::vector<Limb> t(nh + p.size());
+	LimbMul(t.data(), high.data(), nh, p.data(), p.size());
+	LimbAdd(t.data(), t.data(), t.size(), r, nl);
+	size_t n = t.size();
+	while (t[n - 1] == 0) {
+		--n;
+	}
+	memcpy(r, t.data(), sizeof(Limb) * n);
+	return n;
+}
+
+/**
+ * c[0..m) = the 19-digit chunks, lowest first, of a[0..n) < 10^(19 m), zeros on top; a is
+ * overwritten. From DECIMAL_PRINT_THRESHOLD limbs on a is split by LimbDivRem by 10^(19 * 2^k),
+ * 2^k < m, into the low 2^k chunks and the rest.
+ */
+void _LimbToDecimal(Limb *c, Limb *a, size_t n, const size_t &m, const std::vector<std::vector<Limb>> &powers)
+{
+	while (n > 0 && a[n - 1] == 0) {
+		--n;
+	}
+	if (n < DECIMAL_PRINT_THRESHOLD) {
+		const LimbDivisor base(DECIMAL_BASE);
+		size_t i = 0;
+		for (; n > 0; ++i) {
+			c[i] = LimbDiv1(a, a, n, base);
+			while (n > 0 && a[n - 1] == 0) {
+				--n;
+			}
+		}
+		std::fill(c + i, c + m, 0);
+		return;
+	}
+	size_t k = 0;
+	while ((size_t(2) << k) < m) {
+		++k;
+	}
+	const size_t h = size_t(1) << k;
+	const std::vector<Limb> &p = powers[k];
+	if (n < p.size()) {
+		std::fill(c + h, c + m, 0);
+		_LimbToDecimal(c, a, n, h, powers);
+		return;
+	}
+	std::vector<Limb> q(n - p.size() + 1), r(p.size());
+	LimbDivRem(q.data(), r.data(), a, n, p.data(), p.size());
+	_LimbToDecimal(c, r.data(), r.size(), h, powers);
+	_LimbToDecimal(c + h, q.data(), q.size(), m - h, powers);
+}
+
+}
+
+Bint::NewSpaceFailed::NewSpaceFailed() : std::runtime_error("No Enough Memory Space.") {}
+Bint::BadCast::BadCast() : std::invalid_argument("Cannot convert to a Bint object") {}
+Bint::DivideByZero::DivideByZero() : std::domain_error("Division by zero.") {}
+
+/**
+ * Storage for len limbs, in the object when they fit; the old buffer must have been released.
+ * The limbs are not cleared.
+ */
+void Bint::_SafeNewSpace(const size_t &len)
+{
+	if (len <= MIN_CAPACITY) {
+		data = local;
+		capacity = MIN_CAPACITY;
+		return;
+	}
+	data = new Kernel::Limb[len];
+	if (data == nullptr) {
+		throw NewSpaceFailed();
+	}
+	capacity = len;
+}
+
+void Bint::_Release()
+{
+	if (data != local) {
+		delete[] data;
+		data = local;
+		capacity = MIN_CAPACITY;
+	}
+}
+
+/**
+ * Room for len limbs, keeping the value; a heap buffer at least doubles.
+ */
+void Bint::_Reserve(const size_t &len)
+{
+	if (len <= capacity) {
+		return;
+	}
+	const size_t newCapacity = std::max(len, capacity << 1);
+	Kernel::Limb *newMem = new Kernel::Limb[newCapacity];
+	if (newMem == nullptr) {
+		throw NewSpaceFailed();
+	}
+	memcpy(newMem, data, sizeof(Kernel::Limb) * length);
+	_Release();
+	data = newMem;
+	capacity = newCapacity;
+}
+
+/**
+ * Drops the leading zero limbs, zero keeps one limb and has no sign.
+ */
+void Bint::_Trim()
+{
+	while (length > 1 && data[length - 1] == 0) {
+		--length;
+	}
+	if (length == 1 && data[0] == 0) {
+		isMinus = false;
+	}
+}
+
+void Bint::_SetMagnitude(unsigned long long x)
+{
+	data[0] = x;
+	length = 1;
+}
+
+Bint::Bint() {}
+
+Bint::Bint(int x)
+	: Bint(static_cast<long long>(x)) {}
+
+Bint::Bint(long long x)
+{
+	isMinus = x < 0;
+	// negated as unsigned, which also holds the magnitude of LLONG_MIN
+	_SetMagnitude(isMinus ? 0ULL - static_cast<unsigned long long>(x) : static_cast<unsigned long long>(x));
+}
+
+Bint::Bint(const size_t &capa)
+{
+	_SafeNewSpace(capa);
+}
+
+/**
+ * Decimal digits after any number of '-', cut into 19-digit chunks from the end.
+ */
+Bint::Bint(std::string x)
+{
+	size_t begin = 0;
+	bool minus = false;
+	while (begin < x.length() && x[begin] == '-') {
+		minus = !minus;
+		++begin;
+	}
+	const size_t digits = x.length() - begin;
+	if (!digits || x.find_first_not_of("0123456789", begin) != std::string::npos) {
+		throw BadCast();
+	}
+	// 10^19 < 2^64, so every 19 digits need at most one limb
+	const size_t m = (digits + Kernel::DECIMAL_DIGITS - 1) / Kernel::DECIMAL_DIGITS;
+	std::vector<Kernel::Limb> chunks(m);
+	for (size_t i = 0, end = x.length(); i < m; ++i) {
+		const size_t start = end - std::min(end - begin, Kernel::DECIMAL_DIGITS);
+		Kernel::Limb value = 0;
+		for (size_t j = start; j < end; ++j) {
+			value = value * 10 + static_cast<Kernel::Limb>(x[j] - '0');
+		}
+		chunks[i] = value;
+		end = start;
+	}
+	std::vector<std::vector<Kernel::Limb>> powers;
+	if (m >= Kernel::DECIMAL_PARSE_THRESHOLD) {
+		Kernel::_DecimalPowers(powers, m);
+	}
+	_SafeNewSpace(m);
+	length = Kernel::_LimbFromDecimal(data, chunks.data(), m, powers);
+	if (length == 0) {
+		_SetMagnitude(0);
+	}
+	isMinus = minus;
+	_Trim();
+}
+
+Bint::Bint(const Bint &b)
+	: isMinus(b.isMinus), length(b.length)
+{
+	_SafeNewSpace(length);
+	memcpy(data, b.data, sizeof(Kernel::Limb) * length);
+}
+
+/**
+ * A heap buffer is taken over, inline limbs are copied; b is left 0.
+ */
+Bint::Bint(Bint &&b) noexcept
+	: isMinus(b.isMinus), length(b.length)
+{
+	if (b.data != b.local) {
+		data = b.data;
+		capacity = b.capacity;
+		b.data = b.local;
+		b.capacity = MIN_CAPACITY;
+	}
+	else {
+		memcpy(local, b.local, sizeof(local));
+	}
+	b.isMinus = false;
+	b._SetMagnitude(0);
+}
+
+Bint &Bint::operator=(int x)
+{
+	return *this = static_cast<long long>(x);
+}
+
+Bint &Bint::operator=(long long x)
+{
+	isMinus = x < 0;
+	_SetMagnitude(isMinus ? 0ULL - static_cast<unsigned long long>(x) : static_cast<unsigned long long>(x));
 	return *this;
 }
 
@@ -231,11 +1382,12 @@ Bint &Bint::operator=(const Bint &rhs)
 	if (this == &rhs) {
 		return *this;
 	}
-	if (rhs.capacity > capacity) {
-		capacity = rhs.capacity;
-		_SafeNewSpace(data, capacity);
+	if (rhs.length > capacity) {
+		// nothing of the old value needs to be kept
+		length = 0;
+		_Reserve(rhs.length);
 	}
-	memcpy(data, rhs.data, sizeof(unsigned int) * rhs.capacity);
+	memcpy(data, rhs.data, sizeof(Kernel::Limb) * rhs.length);
 	length = rhs.length;
 	isMinus = rhs.isMinus;
 	return *this;
@@ -246,35 +1398,70 @@ Bint &Bint::operator=(Bint &&rhs) noexcept
 	if (this == &rhs) {
 		return *this;
 	}
-	capacity = rhs.capacity;
+	if (rhs.data != rhs.local) {
+		_Release();
+		data = rhs.data;
+		capacity = rhs.capacity;
+		rhs.data = rhs.local;
+		rhs.capacity = MIN_CAPACITY;
+	}
+	else {
+		memcpy(data, rhs.local, sizeof(Kernel::Limb) * rhs.length);
+	}
 	length = rhs.length;
 	isMinus = rhs.isMinus;
-	data = rhs.data;
-	rhs.data = nullptr;
+	rhs.isMinus = false;
+	rhs._SetMagnitude(0);
 	return *this;
 }
 
+/**
+ * Reads one word; at the end of the input, or when the word is not a number, b is kept and
+ * the stream fails.
+ */
 std::istream &operator>>(std::istream &is, Bint &b)
 {
 	std::string s;
-	is >> s;
-	b = Bint(s);
+	if (!(is >> s)) {
+		return is;
+	}
+	try {
+		b = Bint(s);
+	}
+	catch (const Bint::BadCast &) {
+		is.setstate(std::ios::failbit);
+	}
 	return is;
 }
 
+/**
+ * The magnitude is cut into chunks of 19 decimal digits, then printed from the top.
+ */
 std::ostream &operator<<(std::ostream &os, const Bint &b)
 {
-	if (b.data == nullptr) {
-		return os;
+	// 2^64 < 10^(19 * 65 / 64), so this many chunks hold the value
+	size_t m = b.length + b.length / 64 + 1;
+	std::vector<Kernel::Limb> rest(b.data, b.data + b.length), chunks(m);
+	std::vector<std::vector<Kernel::Limb>> powers;
+	if (b.length >= Kernel::DECIMAL_PRINT_THRESHOLD) {
+		Kernel::_DecimalPowers(powers, m);
 	}
-	if (b.isMinus && (b.length > 1 || b.data[0] != 0)) {
-		os << "-";
+	Kernel::_LimbToDecimal(chunks.data(), rest.data(), b.length, m, powers);
+	while (m > 1 && chunks[m - 1] == 0) {
+		--m;
 	}
-	os << b.data[b.length - 1];
-	for (long long i = b.length - 2LL; i >= 0; --i) {
-		os << std::setw(4) << std::setfill('0') << b.data[i];
+	std::string text = b.isMinus ? "-" : "";
+	text += std::to_string(chunks[m - 1]);
+	char digits[Kernel::DECIMAL_DIGITS];
+	for (size_t i = m - 1; i-- > 0;) {
+		Kernel::Limb chunk = chunks[i];
+		for (size_t j = Kernel::DECIMAL_DIGITS; j-- > 0;) {
+			digits[j] = static_cast<char>('0' + chunk % 10);
+			chunk /= 10;
+		}
+		text.append(digits, Kernel::DECIMAL_DIGITS);
 	}
-	return os;
+	return os << text;
 }
 
 Bint abs(const Bint &b)
@@ -287,67 +1474,29 @@ Bint abs(const Bint &b)
 Bint abs(Bint &&b)
 {
 	b.isMinus = false;
-	return b;
+	return std::move(b);
 }
 
 bool operator==(const Bint &lhs, const Bint &rhs)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return false;
-	}
-	if (lhs.length != rhs.length) {
-		return false;
-	}
-	for (size_t i = 0; i < lhs.length; ++i) {
-		if (lhs.data[i] != rhs.data[i]) {
-			return false;
-		}
-	}
-	return true;
+	return lhs.isMinus == rhs.isMinus && lhs.length == rhs.length
+		&& Kernel::LimbCompare(lhs.data, rhs.data, lhs.length) == 0;
 }
 
 bool operator!=(const Bint &lhs, const Bint &rhs)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return true;
-	}
-	if (lhs.length != rhs.length) {
-		return true;
-	}
-	for (size_t i = 0; i < lhs.length; ++i) {
-		if (lhs.data[i] != rhs.data[i]) {
-			return true;
-		}
-	}
-	return false;
+	return !(lhs == rhs);
 }
 
 bool operator<(const Bint &lhs, const Bint &rhs)
 {
 	if (lhs.isMinus != rhs.isMinus) {
-		return !lhs.isMinus;
-	}
-	if (lhs.isMinus) {
-		if (lhs.length != rhs.length) {
-			return lhs.length > rhs.length;
-		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] > rhs.data[i];
-			}
-		}
-		return false;
-	} else {
-		if (lhs.length != rhs.length) {
-			return lhs.length < rhs.length;
-		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] < rhs.data[i];
-			}
-		}
-		return false;
+		return lhs.isMinus;
 	}
+	// compare the magnitudes, the larger one is the smaller number when both are negative
+	int cmp = lhs.length != rhs.length ? (lhs.length < rhs.length ? -1 : 1)
+		: Kernel::LimbCompare(lhs.data, rhs.data, lhs.length);
+	return lhs.isMinus ? cmp > 0 : cmp < 0;
 }
 
 bool operator>(const Bint &lhs, const Bint &rhs)
@@ -357,160 +1506,205 @@ bool operator>(const Bint &lhs, const Bint &rhs)
 
 bool operator<=(const Bint &lhs, const Bint &rhs)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return !lhs.isMinus;
-	}
-	if (lhs.isMinus) {
-		if (lhs.length != rhs.length) {
-			return lhs.length > rhs.length;
-		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] > rhs.data[i];
-			}
-		}
-		return true;
-	} else {
-		if (lhs.length != rhs.length) {
-			return lhs.length < rhs.length;
-		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] < rhs.data[i];
-			}
-		}
-		return true;
-	}
+	return !(rhs < lhs);
 }
 
 bool operator>=(const Bint &lhs, const Bint &rhs)
 {
-	if (lhs.isMinus != rhs.isMinus) {
-		return lhs.isMinus;
-	}
-	if (lhs.isMinus) {
-		if (lhs.length != rhs.length) {
-			return lhs.length < rhs.length;
-		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] < rhs.data[i];
-			}
-		}
-		return true;
-	} else {
-		if (lhs.length != rhs.length) {
-			return lhs.length > rhs.length;
-		}
-		for (long long i = lhs.length - 1; i >= 0; --i) {
-			if (lhs.data[i] != rhs.data[i]) {
-				return lhs.data[i] > rhs.data[i];
-			}
-		}
-		return true;
-	}
+	return !(lhs < rhs);
+}
+
+/**
+ * |lhs| + |rhs| with the given sign.
+ */
+Bint Bint::_AddAbs(const Bint &lhs, const Bint &rhs, const bool &minus)
+{
+	const Bint &a = lhs.length >= rhs.length ? lhs : rhs, &b = lhs.length >= rhs.length ? rhs : lhs;
+	Bint result(a.length + 1);
+	result.data[a.length] = Kernel::LimbAdd(result.data, a.data, a.length, b.data, b.length);
+	result.length = a.length + 1;
+	result.isMinus = minus;
+	result._Trim();
+	return result;
 }
 
+/**
+ * |lhs| - |rhs| with the given sign, flipped when |lhs| < |rhs|.
+ */
+Bint Bint::_SubAbs(const Bint &lhs, const Bint &rhs, const bool &minus)
+{
+	const int cmp = lhs.length != rhs.length ? (lhs.length < rhs.length ? -1 : 1)
+		: Kernel::LimbCompare(lhs.data, rhs.data, lhs.length);
+	const Bint &a = cmp >= 0 ? lhs : rhs, &b = cmp >= 0 ? rhs : lhs;
+	Bint result(a.length);
+	Kernel::LimbSub(result.data, a.data, a.length, b.data, b.length);
+	result.length = a.length;
+	result.isMinus = cmp >= 0 ? minus : !minus;
+	result._Trim();
+	return result;
+}
 
 Bint operator+(const Bint &lhs, const Bint &rhs)
 {
 	if (lhs.isMinus == rhs.isMinus) {
-		size_t maxLen = std::max(lhs.length, rhs.length);
-		size_t expectLen = maxLen + 1;
-		Bint result(expectLen); // special constructor
-		for (size_t i = 0; i < maxLen; ++i) {
-			result.data[i] = lhs.data[i] + rhs.data[i];
-		}
-		for (size_t i = 0; i < maxLen; ++i) {
-			if (result.data[i] > 10000) {
-				result.data[i] -= 10000;
-				++result.data[i + 1];
-			}
-		}
-		result.length = result.data[maxLen] > 0 ? maxLen + 1 : maxLen;
-		result.isMinus = lhs.isMinus;
-		return result;
-	} else {
-		if (lhs.isMinus) {
-			return rhs - abs(lhs);
-		} else {
-			return lhs - abs(rhs);
-		}
+		return Bint::_AddAbs(lhs, rhs, lhs.isMinus);
 	}
+	return Bint::_SubAbs(lhs, rhs, lhs.isMinus);
 }
 
 Bint operator-(const Bint &b)
 {
 	Bint result(b);
 	result.isMinus = !result.isMinus;
+	result._Trim();
 	return result;
 }
 
 Bint operator-(Bint &&b)
 {
 	b.isMinus = !b.isMinus;
-	return b;
+	b._Trim();
+	return std::move(b);
 }
 
 Bint operator-(const Bint &lhs, const Bint &rhs)
 {
-	if (lhs.isMinus == rhs.isMinus) {
-		if (lhs.isMinus) {
-			return -(abs(lhs) - abs(rhs));
-		} else {
-			if (lhs < rhs) {
-				return -(rhs - lhs);
-			}
-			Bint result(std::max(lhs.length, rhs.length));
-			for (size_t i = 0; i < lhs.length; ++i) {
-				result.data[i] = lhs.data[i] - rhs.data[i];
-			}
-			for (size_t i = 0; i < lhs.length; ++i) {
-				if (result.data[i] < 0) {
-					result.data[i] += 10000;
-					++result.data[i + 1];
-				}
-			}
-			while (result.length > 1 && result.data[result.length - 1] == 0) {
-				--result.length;
-			}
-			return result;
-		}
-	} else {
-		return lhs + (-rhs);
+	if (lhs.isMinus != rhs.isMinus) {
+		return Bint::_AddAbs(lhs, rhs, lhs.isMinus);
 	}
+	return Bint::_SubAbs(lhs, rhs, lhs.isMinus);
 }
 
 Bint operator*(const Bint &lhs, const Bint &rhs)
 {
-	size_t expectLen = lhs.length + rhs.length + 2;
+	const size_t expectLen = lhs.length + rhs.length;
 	Bint result(expectLen);
-	for (size_t i = 0; i < lhs.length; ++i) {
-		for (size_t j = 0; j < rhs.length; ++j) {
-			long long tmp = result.data[i + j] + static_cast<long long>(lhs.data[i]) * rhs.data[j];
-			if (tmp >= 10000) {
-				result.data[i + j] = tmp % 10000;
-				result.data[i + j + 1] += static_cast<int>(tmp / 10000);
-			} else {
-				result.data[i + j] = tmp;
-			}
+	if (&lhs == &rhs) {
+		Kernel::LimbSqr(result.data, lhs.data, lhs.length);
+	}
+	else {
+		Kernel::LimbMul(result.data, lhs.data, lhs.length, rhs.data, rhs.length);
+	}
+	result.length = expectLen;
+	result.isMinus = lhs.isMinus != rhs.isMinus;
+	result._Trim();
+	return result;
+}
+
+/**
+ * Truncated division as for the built-in integers: the quotient rounds toward zero and the
+ * remainder has the sign of lhs. Either output may be null.
+ */
+void Bint::_DivMod(const Bint &lhs, const Bint &rhs, Bint *quotient, Bint *remainder)
+{
+	if (rhs.length == 1 && rhs.data[0] == 0) {
+		throw DivideByZero();
+	}
+	if (lhs.length < rhs.length
+		|| (lhs.length == rhs.length && Kernel::LimbCompare(lhs.data, rhs.data, lhs.length) < 0)) {
+		if (remainder != nullptr) {
+			*remainder = lhs;
+		}
+		if (quotient != nullptr) {
+			*quotient = 0;
 		}
+		return;
 	}
-	result.length = lhs.length + rhs.length -1;
-	while (result.data[result.length] > 0) {
-		++result.length;
+	const size_t quotientLen = lhs.length - rhs.length + 1;
+	Bint q(quotientLen), r(rhs.length);
+	Kernel::LimbDivRem(q.data, r.data, lhs.data, lhs.length, rhs.data, rhs.length);
+	q.length = quotientLen;
+	q.isMinus = lhs.isMinus != rhs.isMinus;
+	q._Trim();
+	r.length = rhs.length;
+	r.isMinus = lhs.isMinus;
+	r._Trim();
+	if (quotient != nullptr) {
+		*quotient = std::move(q);
 	}
-	while (result.length > 1 && result.data[result.length - 1] == 0) {
-		--result.length;
+	if (remainder != nullptr) {
+		*remainder = std::move(r);
 	}
+}
+
+Bint operator/(const Bint &lhs, const Bint &rhs)
+{
+	Bint quotient;
+	Bint::_DivMod(lhs, rhs, &quotient, nullptr);
+	return quotient;
+}
+
+Bint operator%(const Bint &lhs, const Bint &rhs)
+{
+	Bint remainder;
+	Bint::_DivMod(lhs, rhs, nullptr, &remainder);
+	return remainder;
+}
+
+std::pair<Bint, Bint> divmod(const Bint &lhs, const Bint &rhs)
+{
+	std::pair<Bint, Bint> result;
+	Bint::_DivMod(lhs, rhs, &result.first, &result.second);
 	return result;
 }
 
-Bint::~Bint()
+/**
+ * Division by a machine integer in one pass over the limbs, without a Bint for the divisor.
+ * The remainder is below |rhs| <= 2^63, so it fits a long long with the sign of lhs.
+ */
+std::pair<Bint, long long> divmod(const Bint &lhs, long long rhs)
 {
-	if (data != nullptr) {
-		delete[] data;
-		data = nullptr;
+	if (!rhs) {
+		throw Bint::DivideByZero();
+	}
+	const Kernel::LimbDivisor div(rhs < 0 ? 0ULL - static_cast<unsigned long long>(rhs) : static_cast<unsigned long long>(rhs));
+	Bint quotient(lhs.length);
+	const Kernel::Limb r = Kernel::LimbDiv1(quotient.data, lhs.data, lhs.length, div);
+	quotient.length = lhs.length;
+	quotient.isMinus = lhs.isMinus != (rhs < 0);
+	quotient._Trim();
+	return std::make_pair(std::move(quotient), lhs.isMinus ? -static_cast<long long>(r) : static_cast<long long>(r));
+}
+
+Bint operator/(const Bint &lhs, long long rhs)
+{
+	return divmod(lhs, rhs).first;
+}
+
+long long operator%(const Bint &lhs, long long rhs)
+{
+	if (!rhs) {
+		throw Bint::DivideByZero();
 	}
+	const Kernel::LimbDivisor div(rhs < 0 ? 0ULL - static_cast<unsigned long long>(rhs) : static_cast<unsigned long long>(rhs));
+	const Kernel::Limb r = Kernel::LimbMod1(lhs.data, lhs.length, div);
+	return lhs.isMinus ? -static_cast<long long>(r) : static_cast<long long>(r);
+}
+
+/**
+ * lhs / rhs for an lhs known to be a multiple of rhs, cheaper than operator/ as no quotient
+ * limb is estimated; any other lhs gives an unspecified result.
+ */
+Bint divexact(const Bint &lhs, const Bint &rhs)
+{
+	if (rhs.length == 1 && rhs.data[0] == 0) {
+		throw Bint::DivideByZero();
+	}
+	if (lhs.length < rhs.length) {
+		// only 0 is a multiple with fewer limbs
+		return Bint();
+	}
+	const size_t quotientLen = lhs.length - rhs.length + 1;
+	Bint quotient(quotientLen);
+	Kernel::LimbDivExact(quotient.data, lhs.data, lhs.length, rhs.data, rhs.length);
+	quotient.length = quotientLen;
+	quotient.isMinus = lhs.isMinus != rhs.isMinus;
+	quotient._Trim();
+	return quotient;
+}
+
+Bint::~Bint()
+{
+	_Release();
 }
 }
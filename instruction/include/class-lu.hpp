@@ -0,0 +1,243 @@
+#ifndef DIAMOND_LU_HPP
+#define DIAMOND_LU_HPP
+
+#include <vector>
+#include <stdexcept>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+#include "class-matrix.hpp"
+
+namespace Diamond {
+
+namespace Kernel {
+
+/**
+ * Columns per panel. Wider panels put more of the work in GEMM and more in the element-wise panel loop.
+ */
+const size_t LU_BLOCK = 128;
+
+}
+
+/**
+ * LU factorization with partial pivoting: P A = L U, L unit lower and U upper triangular.
+ *
+ * Right-looking and blocked: a panel of LU_BLOCK columns is factorized element by element,
+ * the rows of U right of it are solved against its L, and the trailing matrix is updated
+ * by one MultiplyAdd, so most of the O(n^3) work runs in the GEMM kernel.
+ * The triangular solves are blocked the same way, which makes solving for many
+ * right-hand sides at once much cheaper than solving for them one by one.
+ *
+ * Factorize once and call Solve for every new right-hand side.
+ * A zero pivot does not stop the factorization, Det() is then 0 and Solve throws.
+ */
+template<typename _Td>
+class LU {
+	static_assert(std::is_floating_point<_Td>::value, "LU needs a floating point element type");
+
+	Matrix<_Td> lu;
+	std::vector<size_t> pivots;
+	bool odd = false;
+	bool singular = false;
+
+	/**
+	 * Columns [k0, k0 + b) of rows [k0, n): pivots, row swaps over the whole width, L and the panel of U.
+	 */
+	void _FactorPanel(const size_t &k0, const size_t &b)
+	{
+		const size_t n = lu.RowSize();
+		for (size_t j = k0; j < k0 + b; ++j) {
+			size_t p = j;
+			_Td best = std::abs(lu(j, j));
+			for (size_t i = j + 1; i < n; ++i) {
+				if (std::abs(lu(i, j)) > best) {
+					best = std::abs(lu(i, j));
+					p = i;
+				}
+			}
+			pivots[j] = p;
+			if (p != j) {
+				std::swap_ranges(lu[j], lu[j] + n, lu[p]);
+				odd = !odd;
+			}
+			const _Td pivot = lu(j, j);
+			if (pivot == _Td(0)) {
+				singular = true;
+				continue;
+			}
+			const _Td inv = _Td(1) / pivot;
+			const _Td *uj = lu[j];
+			Kernel::ParallelRows(n - j - 1, k0 + b - j, [&](size_t begin, size_t end) {
+				for (size_t i = j + 1 + begin; i < j + 1 + end; ++i) {
+					_Td *li = lu[i];
+					const _Td l = li[j] *= inv;
+					for (size_t c = j + 1; c < k0 + b; ++c) {
+						li[c] -= l * uj[c];
+					}
+				}
+			});
+		}
+	}
+	/**
+	 * x = L^-1 x in place, rows blocked by LU_BLOCK.
+	 */
+	void _SolveLower(Matrix<_Td> &x) const
+	{
+		const size_t n = lu.RowSize(), m = x.ColSize();
+		for (size_t k0 = 0; k0 < n; k0 += Kernel::LU_BLOCK) {
+			const size_t b = std::min(Kernel::LU_BLOCK, n - k0);
+			for (size_t i = k0; i < k0 + b; ++i) {
+				_Td *xi = x[i];
+				for (size_t r = k0; r < i; ++r) {
+					const _Td l = lu(i, r), *xr = x[r];
+					for (size_t c = 0; c < m; ++c) {
+						xi[c] -= l * xr[c];
+					}
+				}
+			}
+			if (k0 + b < n) {
+				MultiplyAdd(x.block(k0 + b, 0, n - k0 - b, m), lu.block(k0 + b, k0, n - k0 - b, b), x.block(k0, 0, b, m), _Td(-1));
+			}
+		}
+	}
+	/**
+	 * x = U^-1 x in place, from the last block of rows up.
+	 */
+	void _SolveUpper(Matrix<_Td> &x) const
+	{
+		const size_t n = lu.RowSize(), m = x.ColSize();
+		for (size_t k1 = n; k1 > 0;) {
+			const size_t k0 = k1 > Kernel::LU_BLOCK ? k1 - Kernel::LU_BLOCK : 0, b = k1 - k0;
+			for (size_t i = k1; i-- > k0;) {
+				_Td *xi = x[i];
+				for (size_t r = i + 1; r < k1; ++r) {
+					const _Td u = lu(i, r), *xr = x[r];
+					for (size_t c = 0; c < m; ++c) {
+						xi[c] -= u * xr[c];
+					}
+				}
+				const _Td inv = _Td(1) / lu(i, i);
+				for (size_t c = 0; c < m; ++c) {
+					xi[c] *= inv;
+				}
+			}
+			if (k0 > 0) {
+				MultiplyAdd(x.block(0, 0, k0, m), lu.block(0, k0, k0, b), x.block(k0, 0, b, m), _Td(-1));
+			}
+			k1 = k0;
+		}
+	}
+public:
+	template<typename _Ex>
+	explicit LU(const MatrixExpr<_Td, _Ex> &A) : lu(A.derived())
+	{
+		const size_t n = lu.RowSize();
+		if (n != lu.ColSize()) {
+			throw std::invalid_argument("The row size and column size are different.");
+		}
+		pivots.resize(n);
+		for (size_t k0 = 0; k0 < n; k0 += Kernel::LU_BLOCK) {
+			const size_t b = std::min(Kernel::LU_BLOCK, n - k0), rest = n - k0 - b;
+			_FactorPanel(k0, b);
+			if (!rest) {
+				continue;
+			}
+			// U12 = L11^-1 A12, then A22 -= L21 U12
+			for (size_t i = k0 + 1; i < k0 + b; ++i) {
+				_Td *ui = lu[i] + k0 + b;
+				for (size_t r = k0; r < i; ++r) {
+					const _Td l = lu(i, r), *ur = lu[r] + k0 + b;
+					for (size_t c = 0; c < rest; ++c) {
+						ui[c] -= l * ur[c];
+					}
+				}
+			}
+			MultiplyAdd(lu.block(k0 + b, k0 + b, rest, rest), lu.block(k0 + b, k0, rest, b), lu.block(k0, k0 + b, b, rest), _Td(-1));
+		}
+	}
+
+	size_t Size() const
+	{
+		return lu.RowSize();
+	}
+	/**
+	 * L below the diagonal (its unit diagonal is not stored) and U on and above it.
+	 */
+	const Matrix<_Td> & Packed() const
+	{
+		return lu;
+	}
+	/**
+	 * Row k was exchanged with row Pivots()[k] >= k, in the order k = 0, 1, ...
+	 */
+	const std::vector<size_t> & Pivots() const
+	{
+		return pivots;
+	}
+	bool Singular() const
+	{
+		return singular;
+	}
+	_Td Det() const
+	{
+		_Td det = odd ? _Td(-1) : _Td(1);
+		for (size_t i = 0; i < lu.RowSize(); ++i) {
+			det *= lu(i, i);
+		}
+		return det;
+	}
+	/**
+	 * X with A X = B, for every column of B.
+	 */
+	template<typename _Ex>
+	Matrix<_Td> Solve(const MatrixExpr<_Td, _Ex> &B) const
+	{
+		Matrix<_Td> x(B.derived());
+		SolveInPlace(x);
+		return x;
+	}
+	void SolveInPlace(Matrix<_Td> &x) const
+	{
+		if (x.RowSize() != lu.RowSize()) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+		if (singular) {
+			throw std::domain_error("The matrix is singular.");
+		}
+		for (size_t k = 0; k < pivots.size(); ++k) {
+			if (pivots[k] != k) {
+				std::swap_ranges(x[k], x[k] + x.ColSize(), x[pivots[k]]);
+			}
+		}
+		_SolveLower(x);
+		_SolveUpper(x);
+	}
+	Matrix<_Td> Inverse() const
+	{
+		Matrix<_Td> x = I<_Td>(lu.RowSize());
+		SolveInPlace(x);
+		return x;
+	}
+};
+
+template<typename _Td, typename _L, typename _R>
+Matrix<_Td> Solve(const MatrixExpr<_Td, _L> &A, const MatrixExpr<_Td, _R> &B)
+{
+	return LU<_Td>(A).Solve(B);
+}
+
+template<typename _Td, typename _Ex>
+Matrix<_Td> Inverse(const MatrixExpr<_Td, _Ex> &A)
+{
+	return LU<_Td>(A).Inverse();
+}
+
+template<typename _Td, typename _Ex>
+_Td Det(const MatrixExpr<_Td, _Ex> &A)
+{
+	return LU<_Td>(A).Det();
+}
+
+}
+#endif
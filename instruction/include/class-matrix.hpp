@@ -5,57 +5,341 @@
 #include <iomanip>
 #include <vector>
 #include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+#include <utility>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <functional>
+#include "matrix-thread.hpp"
+#include "matrix-gemm.hpp"
+#include "matrix-strassen.hpp"
+#include "matrix-expr.hpp"
+#include "matrix-transpose.hpp"
+#include "matrix-view.hpp"
+#include "matrix-fixed.hpp"
+#include "matrix-modular.hpp"
+#include "matrix-io.hpp"
+#include "matrix-batch.hpp"
 
 namespace Diamond {
 
+/**
+ * The elements are kept row-major in one buffer aligned to MATRIX_ALIGNMENT bytes.
+ * Row i starts at data() + i * stride(), stride() >= ColSize().
+ * Rows of arithmetic types of at least MATRIX_PAD_MIN_BYTES are padded
+ * to a multiple of MATRIX_ALIGNMENT bytes, so that every row is aligned too,
+ * and never to a multiple of MATRIX_SET_STRIDE bytes, so that walking down
+ * a column (transposing, packing a GEMM panel) does not hit a single cache set.
+ */
+const size_t MATRIX_ALIGNMENT = 64;
+const size_t MATRIX_PAD_MIN_BYTES = 256;
+const size_t MATRIX_SET_STRIDE = 4096;
+
 template<typename _Td>
-class Matrix {
+class Matrix<_Td, MATRIX_DYNAMIC, MATRIX_DYNAMIC> : public MatrixExpr<_Td, Matrix<_Td>> {
 protected:
 	size_t n_rows = 0;
 	size_t n_cols = 0;
-	std::vector<std::vector<_Td>> data;
-	class RowProxy {
-		std::vector<_Td> &row;
-	public:
-		RowProxy(std::vector<_Td> & _row) : row(_row) {}
-		_Td & operator[](const size_t &pos)
-		{
-			return row[pos];
+	size_t n_stride = 0;
+	_Td *elems = nullptr;
+
+	static size_t _LeadingDim(const size_t &cols)
+	{
+		if (!std::is_arithmetic<_Td>::value || MATRIX_ALIGNMENT % sizeof(_Td) != 0 || cols * sizeof(_Td) < MATRIX_PAD_MIN_BYTES) {
+			return cols;
 		}
-	};
-	class ConstRowProxy {
-		const std::vector<_Td> &row;
-	public:
-		ConstRowProxy(const std::vector<_Td> &_row) : row(_row) {}
-		const _Td & operator[](const size_t &pos) const
-		{
-			return row[pos];
+		const size_t perLine = MATRIX_ALIGNMENT / sizeof(_Td);
+		const size_t ld = (cols + perLine - 1) / perLine * perLine;
+		return ld * sizeof(_Td) % MATRIX_SET_STRIDE ? ld : ld + perLine;
+	}
+	static _Td * _NewSpace(const size_t &len)
+	{
+		if (len == 0) {
+			return nullptr;
 		}
-	};
+		return static_cast<_Td *>(::operator new(len * sizeof(_Td), std::align_val_t(MATRIX_ALIGNMENT)));
+	}
+	static void _DeleteSpace(_Td *p)
+	{
+		if (p) {
+			::operator delete(p, std::align_val_t(MATRIX_ALIGNMENT));
+		}
+	}
+	/**
+	 * Every slot of the buffer, the padding included, holds a constructed _Td.
+	 */
+	void _Release()
+	{
+		if (elems) {
+			std::destroy_n(elems, n_rows * n_stride);
+			_DeleteSpace(elems);
+		}
+		elems = nullptr;
+	}
+	template<typename _Init>
+	void _Build(const size_t &_n_rows, const size_t &_n_cols, _Init init)
+	{
+		const size_t stride = _LeadingDim(_n_cols);
+		_Td *p = _NewSpace(_n_rows * stride);
+		try {
+			init(p, _n_rows * stride, stride);
+		}
+		catch (...) {
+			_DeleteSpace(p);
+			throw;
+		}
+		_Release();
+		n_rows = _n_rows;
+		n_cols = _n_cols;
+		n_stride = stride;
+		elems = p;
+	}
+	/**
+	 * Write every element of an expression of our shape into the buffer.
+	 * Element-wise expressions only read the element they write, so an
+	 * expression may refer to this matrix itself.
+	 */
+	template<typename _Ex>
+	void _CheckSameShape(const _Ex &expr) const
+	{
+		if (n_rows != expr.RowSize() || n_cols != expr.ColSize()) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+	}
+	/**
+	 * Replace every element x at (i, j) by f(x, i, j).
+	 */
+	template<typename _Fn>
+	void _Update(const _Fn &f)
+	{
+		Kernel::ParallelRows(n_rows, n_cols, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				_Td *row = elems + i * n_stride;
+				for (size_t j = 0; j < n_cols; ++j) {
+					row[j] = f(row[j], i, j);
+				}
+			}
+		});
+	}
+	template<typename _Ex>
+	void _Assign(const _Ex &expr)
+	{
+		Kernel::ParallelRows(n_rows, n_cols, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				_Td *row = elems + i * n_stride;
+				for (size_t j = 0; j < n_cols; ++j) {
+					row[j] = expr(i, j);
+				}
+			}
+		});
+	}
+	void _Assign(const TransposedView<_Td> &view)
+	{
+		Kernel::TransposeCopy(n_cols, n_rows, view.data(), view.stride(), elems, n_stride);
+	}
 public:
+	/**
+	 * Walks a column, or any sequence of elements a fixed distance apart.
+	 */
+	template<typename _Tp>
+	class StrideIterator {
+		_Tp *ptr;
+		std::ptrdiff_t step;
+	public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef typename std::remove_const<_Tp>::type value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef _Tp *pointer;
+		typedef _Tp &reference;
+		StrideIterator(_Tp *_ptr = nullptr, const std::ptrdiff_t &_step = 1) : ptr(_ptr), step(_step) {}
+		_Tp & operator*() const { return *ptr; }
+		_Tp * operator->() const { return ptr; }
+		_Tp & operator[](const difference_type &n) const { return ptr[n * step]; }
+		StrideIterator & operator++() { ptr += step; return *this; }
+		StrideIterator operator++(int) { StrideIterator res(*this); ptr += step; return res; }
+		StrideIterator & operator--() { ptr -= step; return *this; }
+		StrideIterator operator--(int) { StrideIterator res(*this); ptr -= step; return res; }
+		StrideIterator & operator+=(const difference_type &n) { ptr += n * step; return *this; }
+		StrideIterator & operator-=(const difference_type &n) { ptr -= n * step; return *this; }
+		StrideIterator operator+(const difference_type &n) const { return StrideIterator(ptr + n * step, step); }
+		StrideIterator operator-(const difference_type &n) const { return StrideIterator(ptr - n * step, step); }
+		difference_type operator-(const StrideIterator &rhs) const { return (ptr - rhs.ptr) / step; }
+		bool operator==(const StrideIterator &rhs) const { return ptr == rhs.ptr; }
+		bool operator!=(const StrideIterator &rhs) const { return ptr != rhs.ptr; }
+		bool operator<(const StrideIterator &rhs) const { return (ptr - rhs.ptr) * step < 0; }
+		bool operator>(const StrideIterator &rhs) const { return rhs < *this; }
+		bool operator<=(const StrideIterator &rhs) const { return !(rhs < *this); }
+		bool operator>=(const StrideIterator &rhs) const { return !(*this < rhs); }
+	};
+	typedef StrideIterator<_Td> ColIterator;
+	typedef StrideIterator<const _Td> ConstColIterator;
+
 	Matrix() {};
 	Matrix(const size_t &_n_rows, const size_t &_n_cols)
-		: n_rows(_n_rows), n_cols(_n_cols), data(std::vector<std::vector<_Td>>(n_rows, std::vector<_Td>(n_cols))) {}
+	{
+		_Build(_n_rows, _n_cols, [](_Td *p, const size_t &len, const size_t &) {
+			std::uninitialized_value_construct_n(p, len);
+		});
+	}
 	Matrix(const size_t &_n_rows, const size_t &_n_cols, const _Td &fillValue)
-		: n_rows(_n_rows), n_cols(_n_cols), data(std::vector<std::vector<_Td>>(n_rows, std::vector<_Td>(n_cols, fillValue))) {}
+	{
+		_Build(_n_rows, _n_cols, [&fillValue](_Td *p, const size_t &len, const size_t &) {
+			std::uninitialized_fill_n(p, len, fillValue);
+		});
+	}
 	Matrix(const Matrix<_Td> &mat)
-		: n_rows(mat.n_rows), n_cols(mat.n_cols), data(mat.data) {}
+	{
+		_Build(mat.n_rows, mat.n_cols, [&mat](_Td *p, const size_t &len, const size_t &) {
+			std::uninitialized_copy_n(mat.elems, len, p);
+		});
+	}
+	/**
+	 * Evaluate an expression such as a + b * 2.0 in one pass.
+	 */
+	template<typename _Ex>
+	Matrix(const MatrixExpr<_Td, _Ex> &expr)
+	{
+		const _Ex &e = expr.derived();
+		_Build(e.RowSize(), e.ColSize(), [](_Td *p, const size_t &len, const size_t &) {
+			std::uninitialized_value_construct_n(p, len);
+		});
+		_Assign(e);
+	}
+	/**
+	 * A temporary expression that owns a matrix is evaluated into its buffer.
+	 */
+	template<typename _Ex, typename = typename std::enable_if<IsMatrixExpr<_Ex>::value && !std::is_reference<_Ex>::value
+		&& !std::is_same<_Ex, Matrix<_Td>>::value && std::is_same<ExprValue<_Ex>, _Td>::value>::type>
+	Matrix(_Ex &&expr)
+	{
+		Matrix<_Td> *owned = ExprBuffer(expr);
+		if (owned && !ExprAliases(expr, ConstMatrixView<_Td>(*owned))) {
+			owned->_Assign(expr);
+			swap(*owned);
+		}
+		else {
+			Matrix<_Td> tmp(static_cast<const MatrixExpr<_Td, _Ex> &>(expr));
+			swap(tmp);
+		}
+	}
 	Matrix(Matrix<_Td> &&mat) noexcept
-		: n_rows(mat.n_rows), n_cols(mat.n_cols), data(mat.data) {}
+		: n_rows(mat.n_rows), n_cols(mat.n_cols), n_stride(mat.n_stride), elems(mat.elems)
+	{
+		mat.n_rows = mat.n_cols = mat.n_stride = 0;
+		mat.elems = nullptr;
+	}
+	/**
+	 * The buffer is reused when the shapes agree.
+	 */
 	Matrix<_Td> & operator=(const Matrix<_Td> &rhs)
 	{
-		this->n_rows = rhs.n_rows;
-		this->n_cols = rhs.n_cols;
-		this->data = rhs.data;
+		if (this == &rhs) {
+			return *this;
+		}
+		if (n_rows == rhs.n_rows && n_cols == rhs.n_cols) {
+			std::copy_n(rhs.elems, n_rows * n_stride, elems);
+		}
+		else {
+			Matrix<_Td> tmp(rhs);
+			swap(tmp);
+		}
 		return *this;
 	}
-	Matrix<_Td> & operator=(Matrix<_Td> &&rhs)
+	Matrix<_Td> & operator=(Matrix<_Td> &&rhs) noexcept
 	{
-		this->n_rows = rhs.n_rows;
-		this->n_cols = rhs.n_cols;
-		this->data = rhs.data;
+		if (this != &rhs) {
+			_Release();
+			n_rows = rhs.n_rows;
+			n_cols = rhs.n_cols;
+			n_stride = rhs.n_stride;
+			elems = rhs.elems;
+			rhs.n_rows = rhs.n_cols = rhs.n_stride = 0;
+			rhs.elems = nullptr;
+		}
 		return *this;
 	}
+	/**
+	 * The buffer is reused when the shapes agree,
+	 * unless the expression reads this matrix transposed.
+	 */
+	template<typename _Ex>
+	Matrix<_Td> & operator=(const MatrixExpr<_Td, _Ex> &expr)
+	{
+		const _Ex &e = expr.derived();
+		if (n_rows == e.RowSize() && n_cols == e.ColSize() && !ExprAliases(e, ConstMatrixView<_Td>(*this))) {
+			_Assign(e);
+		}
+		else {
+			Matrix<_Td> tmp(e);
+			swap(tmp);
+		}
+		return *this;
+	}
+	template<typename _Ex, typename = typename std::enable_if<IsMatrixExpr<_Ex>::value && !std::is_reference<_Ex>::value
+		&& !std::is_same<_Ex, Matrix<_Td>>::value && std::is_same<ExprValue<_Ex>, _Td>::value>::type>
+	Matrix<_Td> & operator=(_Ex &&expr)
+	{
+		Matrix<_Td> *owned = ExprBuffer(expr);
+		if ((n_rows == expr.RowSize() && n_cols == expr.ColSize()) || !owned || ExprAliases(expr, ConstMatrixView<_Td>(*owned))) {
+			return *this = static_cast<const MatrixExpr<_Td, _Ex> &>(expr);
+		}
+		owned->_Assign(expr);
+		swap(*owned);
+		return *this;
+	}
+	/**
+	 * Compound assignment works in place, only *= by a matrix needs a new buffer.
+	 */
+	template<typename _Ex>
+	Matrix<_Td> & operator+=(const MatrixExpr<_Td, _Ex> &expr)
+	{
+		const _Ex &e = expr.derived();
+		_CheckSameShape(e);
+		if (ExprAliases(e, ConstMatrixView<_Td>(*this))) {
+			return *this += Matrix<_Td>(e);
+		}
+		_Update([&e](const _Td &x, const size_t &i, const size_t &j) { return x + e(i, j); });
+		return *this;
+	}
+	template<typename _Ex>
+	Matrix<_Td> & operator-=(const MatrixExpr<_Td, _Ex> &expr)
+	{
+		const _Ex &e = expr.derived();
+		_CheckSameShape(e);
+		if (ExprAliases(e, ConstMatrixView<_Td>(*this))) {
+			return *this -= Matrix<_Td>(e);
+		}
+		_Update([&e](const _Td &x, const size_t &i, const size_t &j) { return x - e(i, j); });
+		return *this;
+	}
+	template<typename _Ex>
+	Matrix<_Td> & operator*=(const MatrixExpr<_Td, _Ex> &expr)
+	{
+		Matrix<_Td> product = *this * expr.derived();
+		swap(product);
+		return *this;
+	}
+	Matrix<_Td> & operator*=(const _Td &b)
+	{
+		_Update([&b](const _Td &x, const size_t &, const size_t &) { return x * b; });
+		return *this;
+	}
+	Matrix<_Td> & operator/=(const double &b)
+	{
+		_Update([&b](const _Td &x, const size_t &, const size_t &) { return x / b; });
+		return *this;
+	}
+	void swap(Matrix<_Td> &other) noexcept
+	{
+		std::swap(n_rows, other.n_rows);
+		std::swap(n_cols, other.n_cols);
+		std::swap(n_stride, other.n_stride);
+		std::swap(elems, other.elems);
+	}
 	inline const size_t & RowSize() const
 	{
 		return n_rows;
@@ -64,161 +348,409 @@ public:
 	{
 		return n_cols;
 	}
-	RowProxy operator[](const size_t &Kth)
+	/**
+	 * Distance in elements between the starts of two adjacent rows.
+	 */
+	inline const size_t & stride() const
+	{
+		return n_stride;
+	}
+	inline _Td * data()
+	{
+		return elems;
+	}
+	inline const _Td * data() const
+	{
+		return elems;
+	}
+	/**
+	 * m[i] is a pointer to row i, so m[i][j] costs one multiply-add.
+	 */
+	inline _Td * operator[](const size_t &Kth)
+	{
+		return elems + Kth * n_stride;
+	}
+	inline const _Td * operator[](const size_t &Kth) const
+	{
+		return elems + Kth * n_stride;
+	}
+	inline _Td & operator()(const size_t &i, const size_t &j)
+	{
+		return elems[i * n_stride + j];
+	}
+	inline const _Td & operator()(const size_t &i, const size_t &j) const
+	{
+		return elems[i * n_stride + j];
+	}
+	inline _Td * RowBegin(const size_t &Kth)
+	{
+		return elems + Kth * n_stride;
+	}
+	inline _Td * RowEnd(const size_t &Kth)
+	{
+		return elems + Kth * n_stride + n_cols;
+	}
+	inline const _Td * RowBegin(const size_t &Kth) const
+	{
+		return elems + Kth * n_stride;
+	}
+	inline const _Td * RowEnd(const size_t &Kth) const
+	{
+		return elems + Kth * n_stride + n_cols;
+	}
+	ColIterator ColBegin(const size_t &Kth)
+	{
+		return ColIterator(elems + Kth, n_stride);
+	}
+	ColIterator ColEnd(const size_t &Kth)
+	{
+		return ColIterator(elems + n_rows * n_stride + Kth, n_stride);
+	}
+	ConstColIterator ColBegin(const size_t &Kth) const
+	{
+		return ConstColIterator(elems + Kth, n_stride);
+	}
+	ConstColIterator ColEnd(const size_t &Kth) const
+	{
+		return ConstColIterator(elems + n_rows * n_stride + Kth, n_stride);
+	}
+	/**
+	 * The h x w elements from (r, c), written and read in place, see matrix-view.hpp.
+	 */
+	MatrixView<_Td> block(const size_t &r, const size_t &c, const size_t &h, const size_t &w)
 	{
-		return RowProxy(this->data[Kth]);
+		return MatrixView<_Td>(*this).block(r, c, h, w);
 	}
-	const ConstRowProxy operator[](const size_t &Kth) const
+	ConstMatrixView<_Td> block(const size_t &r, const size_t &c, const size_t &h, const size_t &w) const
 	{
-		return ConstRowProxy(this->data[Kth]);
+		return ConstMatrixView<_Td>(*this).block(r, c, h, w);
+	}
+	MatrixView<_Td> row(const size_t &i)
+	{
+		return block(i, 0, 1, n_cols);
+	}
+	ConstMatrixView<_Td> row(const size_t &i) const
+	{
+		return block(i, 0, 1, n_cols);
+	}
+	MatrixView<_Td> col(const size_t &j)
+	{
+		return block(0, j, n_rows, 1);
+	}
+	ConstMatrixView<_Td> col(const size_t &j) const
+	{
+		return block(0, j, n_rows, 1);
+	}
+	~Matrix()
+	{
+		_Release();
 	}
-	~Matrix() = default;
 };
 
-/**
- * Sum of two matrics.
- */
-template<typename _Td>
-Matrix<_Td> operator+(const Matrix<_Td> &a, const Matrix<_Td> &b)
+template<typename _Td, typename _L, typename _R>
+bool operator==(const MatrixExpr<_Td, _L> &lhs, const MatrixExpr<_Td, _R> &rhs)
 {
+	const _L &a = lhs.derived();
+	const _R &b = rhs.derived();
 	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) {
-		throw std::invalid_argument("different matrics\'s sizes");
+		return false;
 	}
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
 	for (size_t i = 0; i < a.RowSize(); ++i) {
 		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] + b[i][j];
+			if (a(i, j) != b(i, j))
+				return false;
 		}
 	}
-	return c;
+	return true;
 }
 
+/**
+ * A Matrix as it is, any other expression evaluated into a new Matrix.
+ */
 template<typename _Td>
-Matrix<_Td> operator-(const Matrix<_Td> &a, const Matrix<_Td> &b)
+const Matrix<_Td> & Materialize(const Matrix<_Td> &mat)
 {
-	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) {
-		throw std::invalid_argument("different matrics\'s sizes");
-	}
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] - b[i][j];
-		}
+	return mat;
+}
+
+template<typename _Td, typename _Ex>
+Matrix<_Td> Materialize(const MatrixExpr<_Td, _Ex> &expr)
+{
+	return Matrix<_Td>(expr.derived());
+}
+
+/**
+ * An operand the GEMM kernel reads where it is, through a row and a column stride.
+ */
+template<typename _Td>
+struct GemmOperand {
+	const _Td *ptr;
+	size_t rows, cols;
+	std::ptrdiff_t rs, cs;
+	const _Td & operator()(const size_t &i, const size_t &j) const
+	{
+		return ptr[static_cast<std::ptrdiff_t>(i) * rs + static_cast<std::ptrdiff_t>(j) * cs];
 	}
-	return c;
+};
+
+template<typename _Tp>
+struct IsGemmOperand : std::false_type {};
+template<typename _Td>
+struct IsGemmOperand<Matrix<_Td>> : std::true_type {};
+template<typename _Td>
+struct IsGemmOperand<ConstMatrixView<_Td>> : std::true_type {};
+template<typename _Td>
+struct IsGemmOperand<MatrixView<_Td>> : std::true_type {};
+template<typename _Td>
+struct IsGemmOperand<TransposedView<_Td>> : std::true_type {};
+
+template<typename _Td>
+GemmOperand<_Td> AsGemmOperand(const Matrix<_Td> &mat)
+{
+	return GemmOperand<_Td>{mat.data(), mat.RowSize(), mat.ColSize(), static_cast<std::ptrdiff_t>(mat.stride()), 1};
 }
+
 template<typename _Td>
-bool operator==(const Matrix<_Td> &a, const Matrix<_Td> &b)
+GemmOperand<_Td> AsGemmOperand(const ConstMatrixView<_Td> &view)
 {
-	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) {
-		return false;
+	return GemmOperand<_Td>{view.data(), view.RowSize(), view.ColSize(), static_cast<std::ptrdiff_t>(view.stride()), 1};
+}
+
+template<typename _Td>
+GemmOperand<_Td> AsGemmOperand(const MatrixView<_Td> &view)
+{
+	return AsGemmOperand(ConstMatrixView<_Td>(view));
+}
+
+template<typename _Td>
+GemmOperand<_Td> AsGemmOperand(const TransposedView<_Td> &view)
+{
+	return GemmOperand<_Td>{view.data(), view.RowSize(), view.ColSize(), 1, static_cast<std::ptrdiff_t>(view.stride())};
+}
+
+/**
+ * A factor of a product: read in place when it is a matrix or a view,
+ * any other expression is evaluated into storage first.
+ */
+template<typename _Td, typename _Ex>
+GemmOperand<_Td> _ProductOperand(const MatrixExpr<_Td, _Ex> &expr, Matrix<_Td> &storage)
+{
+	if constexpr (IsGemmOperand<_Ex>::value) {
+		return AsGemmOperand(expr.derived());
 	}
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			if (a[i][j] != b[i][j])
-				return false;
-		}
+	else {
+		storage = expr.derived();
+		return AsGemmOperand(storage);
 	}
-	return true;
 }
 
 template<typename _Td>
-Matrix<_Td> operator-(const Matrix<_Td> &mat)
+bool _ReadsFrom(const GemmOperand<_Td> &op, const ConstMatrixView<_Td> &dst)
 {
-	Matrix<_Td> result(mat.RowSize(), mat.ColSize());
-	for (size_t i = 0; i < mat.RowSize(); ++i) {
-		for (size_t j = 0; j < mat.ColSize(); ++j) {
-			result[i][j] = -mat[i][j];
-		}
+	if (op.cs == 1) {
+		return _ViewsOverlap(op.ptr, op.rows, op.cols, static_cast<size_t>(op.rs), dst.data(), dst.RowSize(), dst.ColSize(), dst.stride());
 	}
-	return result;
+	return _ViewsOverlap(op.ptr, op.cols, op.rows, static_cast<size_t>(op.cs), dst.data(), dst.RowSize(), dst.ColSize(), dst.stride());
 }
 
 template<typename _Td>
-Matrix<_Td> operator-(Matrix<_Td> &&mat)
+void _MultiplyInto(Matrix<_Td> &c, const GemmOperand<_Td> &a, const GemmOperand<_Td> &b)
 {
-	for (size_t i = 0; i < mat.RowSize(); ++i) {
-		for (size_t j = 0; j < mat.ColSize(); ++j) {
-			mat[i][j] = -mat[i][j];
-		}
+	if (a.cols != b.rows) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	if (_ReadsFrom(a, ConstMatrixView<_Td>(c)) || _ReadsFrom(b, ConstMatrixView<_Td>(c))) {
+		Matrix<_Td> tmp;
+		_MultiplyInto(tmp, a, b);
+		c.swap(tmp);
+		return;
+	}
+	if (c.RowSize() != a.rows || c.ColSize() != b.cols) {
+		c = Matrix<_Td>(a.rows, b.cols);
+	}
+	if constexpr (Kernel::GemmSupported<_Td>::value) {
+		Kernel::Gemm<_Td>(a.rows, b.cols, a.cols, _Td(1), a.ptr, a.rs, a.cs, b.ptr, b.rs, b.cs, _Td(0), c.data(), c.stride());
+	}
+	else {
+		Kernel::ParallelRows(a.rows, b.cols * a.cols, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				for (size_t j = 0; j < b.cols; ++j) {
+					_Td sum = _Td();
+					for (size_t k = 0; k < a.cols; ++k) {
+						sum = sum + a(i, k) * b(k, j);
+					}
+					c[i][j] = sum;
+				}
+			}
+		});
 	}
-	return mat;
 }
 
 /**
- * Multiplication of two matrics.
+ * c = a * b without allocating when c already has the shape of the product.
+ * Arithmetic types go through the blocked kernel of matrix-gemm.hpp,
+ * other types keep the plain triple loop.
+ * Matrices and views are read in place, other expressions are evaluated first.
  */
-template<typename _Td>
-Matrix<_Td> operator*(const Matrix<_Td> &a, const Matrix<_Td> &b)
+template<typename _Td, typename _L, typename _R>
+void MultiplyInto(Matrix<_Td> &c, const MatrixExpr<_Td, _L> &a, const MatrixExpr<_Td, _R> &b)
 {
-	if (a.ColSize() != b.RowSize()) {
+	Matrix<_Td> sa, sb;
+	const GemmOperand<_Td> oa = _ProductOperand(a, sa), ob = _ProductOperand(b, sb);
+	_MultiplyInto(c, oa, ob);
+}
+
+/**
+ * c = alpha * a * b + beta * c, where c is a view such as a block of a larger matrix.
+ * When beta is 0, c is overwritten without being read.
+ * A factor overlapping c is multiplied into a new matrix first.
+ */
+template<typename _Td, typename _L, typename _R>
+void MultiplyAdd(const MatrixView<_Td> &c, const MatrixExpr<_Td, _L> &a, const MatrixExpr<_Td, _R> &b,
+	const _Td &alpha = _Td(1), const _Td &beta = _Td(1))
+{
+	Matrix<_Td> sa, sb;
+	const GemmOperand<_Td> oa = _ProductOperand(a, sa), ob = _ProductOperand(b, sb);
+	if (oa.cols != ob.rows || c.RowSize() != oa.rows || c.ColSize() != ob.cols) {
 		throw std::invalid_argument("different matrics\'s sizes");
 	}
-	Matrix<_Td> c(a.RowSize(), b.ColSize(), 0);
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < b.ColSize(); ++j) {
-			for (size_t k = 0; k < a.ColSize(); ++k) {
-				c[i][j] += a[i][k] * b[k][j];
-			}
+	if (_ReadsFrom(oa, ConstMatrixView<_Td>(c)) || _ReadsFrom(ob, ConstMatrixView<_Td>(c))) {
+		Matrix<_Td> product;
+		_MultiplyInto(product, oa, ob);
+		if (beta == _Td(0)) {
+			c = product * alpha;
 		}
+		else {
+			c = product * alpha + c * beta;
+		}
+		return;
+	}
+	if constexpr (Kernel::GemmSupported<_Td>::value) {
+		Kernel::Gemm<_Td>(oa.rows, ob.cols, oa.cols, alpha, oa.ptr, oa.rs, oa.cs, ob.ptr, ob.rs, ob.cs, beta, c.data(), c.stride());
+	}
+	else {
+		Kernel::ParallelRows(oa.rows, ob.cols * oa.cols, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				for (size_t j = 0; j < ob.cols; ++j) {
+					_Td sum = _Td();
+					for (size_t k = 0; k < oa.cols; ++k) {
+						sum = sum + oa(i, k) * ob(k, j);
+					}
+					c(i, j) = beta == _Td(0) ? alpha * sum : alpha * sum + beta * c(i, j);
+				}
+			}
+		});
 	}
-	return c;
+}
+
+template<typename _Td, typename _L, typename _R>
+void MultiplyInto(const MatrixView<_Td> &c, const MatrixExpr<_Td, _L> &a, const MatrixExpr<_Td, _R> &b)
+{
+	MultiplyAdd(c, a, b, _Td(1), _Td(0));
 }
 
 /**
- * Operations between a number and a matrix;
+ * c = a * b by Strassen-Winograd down to products with a side of at most cutoff,
+ * see matrix-strassen.hpp for the accuracy it trades. Only for arithmetic types.
  */
-template<typename _Td>
-Matrix<_Td> operator*(const Matrix<_Td> &a, const _Td &b)
+template<typename _Td, typename _L, typename _R>
+void StrassenMultiplyInto(Matrix<_Td> &c, const MatrixExpr<_Td, _L> &a, const MatrixExpr<_Td, _R> &b,
+	const size_t &cutoff = Kernel::STRASSEN_CUTOFF)
 {
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] * b;
-		}
+	Matrix<_Td> sa, sb;
+	GemmOperand<_Td> oa = _ProductOperand(a, sa), ob = _ProductOperand(b, sb);
+	if (oa.cols != ob.rows) {
+		throw std::invalid_argument("different matrics\'s sizes");
 	}
-	return c;
+	// the additions want rows, transposed views are turned first
+	if (oa.cs != 1) {
+		sa = a.derived();
+		oa = AsGemmOperand(sa);
+	}
+	if (ob.cs != 1) {
+		sb = b.derived();
+		ob = AsGemmOperand(sb);
+	}
+	if (_ReadsFrom(oa, ConstMatrixView<_Td>(c)) || _ReadsFrom(ob, ConstMatrixView<_Td>(c))) {
+		Matrix<_Td> tmp;
+		StrassenMultiplyInto(tmp, ConstMatrixView<_Td>(oa.ptr, oa.rows, oa.cols, oa.rs), ConstMatrixView<_Td>(ob.ptr, ob.rows, ob.cols, ob.rs), cutoff);
+		c.swap(tmp);
+		return;
+	}
+	if (c.RowSize() != oa.rows || c.ColSize() != ob.cols) {
+		c = Matrix<_Td>(oa.rows, ob.cols);
+	}
+	Kernel::Strassen<_Td>(oa.rows, ob.cols, oa.cols, oa.ptr, oa.rs, ob.ptr, ob.rs, c.data(), c.stride(), cutoff);
 }
 
-template<typename _Td>
-Matrix<_Td> operator*(const _Td &b, const Matrix<_Td> &a)
+template<typename _Td, typename _L, typename _R>
+Matrix<_Td> StrassenMultiply(const MatrixExpr<_Td, _L> &a, const MatrixExpr<_Td, _R> &b,
+	const size_t &cutoff = Kernel::STRASSEN_CUTOFF)
 {
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] * b;
-		}
-	}
+	Matrix<_Td> c;
+	StrassenMultiplyInto(c, a, b, cutoff);
 	return c;
 }
 
-template<typename _Td>
-Matrix<_Td> operator/(const Matrix<_Td> &a, const double &b)
+/**
+ * Multiplication of two matrics.
+ */
+template<typename _L, typename _R, typename = EnableIfExprs<_L, _R>>
+Matrix<ExprValue<_L>> operator*(_L &&a, _R &&b)
 {
-	Matrix<_Td> c(a.RowSize(), a.ColSize());
-	for (size_t i = 0; i < a.RowSize(); ++i) {
-		for (size_t j = 0; j < a.ColSize(); ++j) {
-			c[i][j] = a[i][j] / b;
-		}
-	}
+	Matrix<ExprValue<_L>> c;
+	MultiplyInto(c, a, b);
 	return c;
 }
 
+/**
+ * A new matrix holding the transpose, filled by the cache-oblivious kernel of matrix-transpose.hpp.
+ * Transposed(a) gives a view instead, for products and expressions.
+ */
 template<typename _Td>
 Matrix<_Td> Transpose(const Matrix<_Td> &a)
 {
 	Matrix<_Td> res(a.ColSize(), a.RowSize());
-	for (size_t i = 0; i < a.ColSize(); ++i) {
-		for (size_t j = 0; j < a.RowSize(); ++j) {
-			res[i][j] = a[j][i];
-		}
-	}
+	Kernel::TransposeCopy(a.RowSize(), a.ColSize(), a.data(), a.stride(), res.data(), res.stride());
 	return res;
 }
 
+template<typename _Td, typename _Ex>
+Matrix<_Td> Transpose(const MatrixExpr<_Td, _Ex> &a)
+{
+	const _Ex &e = a.derived();
+	if constexpr (std::is_same<_Ex, ConstMatrixView<_Td>>::value || std::is_same<_Ex, MatrixView<_Td>>::value) {
+		Matrix<_Td> res(e.ColSize(), e.RowSize());
+		Kernel::TransposeCopy(e.RowSize(), e.ColSize(), e.data(), e.stride(), res.data(), res.stride());
+		return res;
+	}
+	else if constexpr (std::is_same<_Ex, TransposedView<_Td>>::value) {
+		return Matrix<_Td>(e.Source());
+	}
+	else {
+		return Transpose(Matrix<_Td>(e));
+	}
+}
+
+/**
+ * Square matrices are transposed without a second buffer, other shapes through a new one.
+ */
 template<typename _Td>
-std::ostream & operator<<(std::ostream &stream, const Matrix<_Td> &mat)
+void TransposeInPlace(Matrix<_Td> &a)
 {
+	if (a.RowSize() == a.ColSize()) {
+		Kernel::TransposeSquare(a.RowSize(), a.data(), a.stride());
+	}
+	else {
+		Matrix<_Td> res = Transpose(a);
+		a.swap(res);
+	}
+}
+
+template<typename _Td, typename _Ex>
+std::ostream & operator<<(std::ostream &stream, const MatrixExpr<_Td, _Ex> &expr)
+{
+	const _Ex &mat = expr.derived();
 	std::ostream::fmtflags oldFlags = stream.flags();
 	stream.precision(8);
 	stream.setf(std::ios::fixed | std::ios::right);
@@ -226,7 +758,7 @@ std::ostream & operator<<(std::ostream &stream, const Matrix<_Td> &mat)
 	stream << '\n';
 	for (size_t i = 0; i < mat.RowSize(); ++i) {
 		for (size_t j = 0; j < mat.ColSize(); ++j) {
-			stream << std::setw(15) << mat[i][j];
+			stream << std::setw(15) << mat(i, j);
 		}
 		stream << '\n';
 	}
@@ -245,23 +777,142 @@ Matrix<_Td> I(const size_t &n)
 	return res;
 }
 
+/**
+ * A to the power b by repeated squaring. The exponent is counted down in a copy, the caller's is left as it is.
+ */
 template<typename _Td>
-Matrix<_Td> Pow(Matrix<_Td> A, size_t &b)
+Matrix<_Td> Pow(Matrix<_Td> A, const size_t &b)
 {
 	if (A.RowSize() != A.ColSize()) {
 		throw std::invalid_argument("The row size and column size are different.");
 	}
-	Matrix<_Td> result = I<_Td>(A.ColSize());
-	while (b > 0) {
-		if (b & static_cast<size_t>(1)) {
-			result = result * A;
+	// the products go to work and are swapped in, so no step allocates
+	Matrix<_Td> result = I<_Td>(A.ColSize()), work(A.RowSize(), A.ColSize());
+	size_t e = b;
+	while (e > 0) {
+		if (e & static_cast<size_t>(1)) {
+			MultiplyInto(work, result, A);
+			result.swap(work);
+		}
+		e = e >> static_cast<size_t>(1);
+		if (e > 0) {
+			MultiplyInto(work, A, A);
+			A.swap(work);
 		}
-		A = A * A;
-		b = b >> static_cast<size_t>(1);
 	}
 	return result;
 }
 
+template<typename _Td, typename _Ex>
+Matrix<_Td> Pow(const MatrixExpr<_Td, _Ex> &A, const size_t &b)
+{
+	return Pow(Matrix<_Td>(A.derived()), b);
+}
+
+/**
+ * The residue of x modulo m in [0, m), for negative x too.
+ */
+template<typename _Td>
+uint64_t _Residue(const _Td &x, const uint64_t &m)
+{
+	if constexpr (std::is_signed<_Td>::value) {
+		if (x < 0) {
+			const uint64_t y = static_cast<uint64_t>(-(x + 1)) % m;
+			return (m - 1 - y) % m;
+		}
+	}
+	return static_cast<uint64_t>(x) % m;
 }
-#endif
 
+template<typename _Tw, typename _Td, typename _Ex, typename _In, typename _Mul, typename _Out>
+Matrix<_Td> _PowMod(const MatrixExpr<_Td, _Ex> &expr, const size_t &b, const uint64_t &mod,
+	const _In &in, const _Tw &one, const _Mul &mul, const _Out &out)
+{
+	const _Ex &A = expr.derived();
+	const size_t n = A.RowSize();
+	std::vector<_Tw> base(n * n), result;
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t j = 0; j < n; ++j) {
+			base[i * n + j] = in(_Residue(static_cast<_Td>(A(i, j)), mod));
+		}
+	}
+	Kernel::ModPow(n, base, b, result, one, mul);
+	Matrix<_Td> res(n, n);
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t j = 0; j < n; ++j) {
+			res(i, j) = static_cast<_Td>(out(result[i * n + j]));
+		}
+	}
+	return res;
+}
+
+/**
+ * A to the power b modulo mod, for integer matrices, with entries in [0, mod).
+ * The entries of A may be negative; the result must fit in _Td.
+ * See matrix-modular.hpp for the reduction used for each modulus.
+ */
+template<typename _Td, typename _Ex>
+Matrix<_Td> PowMod(const MatrixExpr<_Td, _Ex> &A, const size_t &b, const uint64_t &mod)
+{
+	static_assert(std::is_integral<_Td>::value, "PowMod needs an integer element type");
+	if (A.RowSize() != A.ColSize()) {
+		throw std::invalid_argument("The row size and column size are different.");
+	}
+	if (mod == 0) {
+		throw std::invalid_argument("The modulus is zero.");
+	}
+	const size_t n = A.RowSize();
+	if (mod == 1) {
+		return Matrix<_Td>(n, n, _Td(0));
+	}
+	auto same = [](const uint64_t &x) { return x; };
+	if (mod <= UINT32_MAX) {
+		const Kernel::ModBarrett red(mod);
+		return _PowMod<uint32_t>(A, b, mod, same, uint32_t(1), [&](uint32_t *c, const uint32_t *a, const uint32_t *x) {
+			Kernel::ModGemm32(n, n, n, a, x, c, red);
+		}, same);
+	}
+	if ((mod & 1) && mod < (uint64_t(1) << 63)) {
+		const Kernel::ModMontgomery red(mod);
+		return _PowMod<uint64_t>(A, b, mod, [&](const uint64_t &x) { return red.To(x); }, red.To(1),
+			[&](uint64_t *c, const uint64_t *a, const uint64_t *x) { Kernel::ModGemm64(n, n, n, a, x, c, red); },
+			[&](const uint64_t &x) { return red.From(x); });
+	}
+	const Kernel::ModPlainWide red(mod);
+	return _PowMod<uint64_t>(A, b, mod, same, uint64_t(1), [&](uint64_t *c, const uint64_t *a, const uint64_t *x) {
+		Kernel::ModGemm64(n, n, n, a, x, c, red);
+	}, same);
+}
+
+/**
+ * The same with the modulus fixed at compile time, e.g. PowMod<1000000007>(A, b),
+ * so that the reductions are multiplications by constants.
+ */
+template<uint64_t _Mod, typename _Td, typename _Ex>
+Matrix<_Td> PowMod(const MatrixExpr<_Td, _Ex> &A, const size_t &b)
+{
+	static_assert(std::is_integral<_Td>::value, "PowMod needs an integer element type");
+	static_assert(_Mod > 1, "the modulus must be at least 2");
+	if (A.RowSize() != A.ColSize()) {
+		throw std::invalid_argument("The row size and column size are different.");
+	}
+	const size_t n = A.RowSize();
+	auto same = [](const uint64_t &x) { return x; };
+	if constexpr (_Mod <= UINT32_MAX) {
+		return _PowMod<uint32_t>(A, b, _Mod, same, uint32_t(1), [&](uint32_t *c, const uint32_t *a, const uint32_t *x) {
+			Kernel::ModGemm32(n, n, n, a, x, c, Kernel::ModConst<_Mod>());
+		}, same);
+	}
+	else if constexpr ((_Mod & 1) && _Mod < (uint64_t(1) << 63)) {
+		constexpr Kernel::ModMontgomery red(_Mod);
+		return _PowMod<uint64_t>(A, b, _Mod, [&](const uint64_t &x) { return red.To(x); }, red.To(1),
+			[&](uint64_t *c, const uint64_t *a, const uint64_t *x) { Kernel::ModGemm64(n, n, n, a, x, c, red); },
+			[&](const uint64_t &x) { return red.From(x); });
+	}
+	else {
+		return PowMod(A, b, _Mod);
+	}
+}
+
+}
+#endif
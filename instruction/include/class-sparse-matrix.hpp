@@ -0,0 +1,398 @@
+#ifndef DIAMOND_SPARSE_MATRIX_HPP
+#define DIAMOND_SPARSE_MATRIX_HPP
+
+#include <vector>
+#include <stdexcept>
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+#include "matrix-thread.hpp"
+#include "class-matrix.hpp"
+
+namespace Diamond {
+
+/**
+ * A matrix that stores only its non-zero elements.
+ *
+ * CSR keeps the non-zeros row after row: the ones of row i are at positions
+ * Pointers()[i] to Pointers()[i + 1] of Indices() (their columns) and Values().
+ * CSC is the same with rows and columns exchanged. Within a row (column) the
+ * indices are increasing and unique.
+ *
+ * Products with dense operands read A once and are split between the threads of
+ * Kernel::Pool() by number of non-zeros, not of rows, so that a few dense rows
+ * do not keep one thread busy while the others wait. Only CSR products are
+ * threaded: a CSC product scatters into the rows of the result.
+ */
+enum class SparseFormat { CSR, CSC };
+
+template<typename _Td>
+struct SparseTriplet {
+	size_t row, col;
+	_Td value;
+};
+
+namespace Kernel {
+
+/**
+ * f(begin, end) over blocks of rows (columns) holding about the same number of non-zeros.
+ */
+template<typename _Fn>
+void ParallelNonZeros(const std::vector<size_t> &ptr, const size_t &cols, _Fn &&f)
+{
+	const size_t majors = ptr.size() - 1, work = ptr.back() * std::max(cols, size_t(1)) + majors;
+	const size_t blocks = std::min(std::min(Pool().Size(), work / PARALLEL_MIN_ELEMS), majors);
+	if (blocks <= 1) {
+		f(size_t(0), majors);
+		return;
+	}
+	auto bound = [&](const size_t &t) {
+		if (t == blocks) {
+			return majors;
+		}
+		const size_t pos = std::lower_bound(ptr.begin(), ptr.end(), ptr.back() * t / blocks) - ptr.begin();
+		return std::min(pos, majors);
+	};
+	Pool().Run(blocks, [&](size_t t) {
+		f(bound(t), bound(t + 1));
+	});
+}
+
+}
+
+template<typename _Td>
+class SparseMatrix {
+protected:
+	size_t n_rows = 0;
+	size_t n_cols = 0;
+	SparseFormat format = SparseFormat::CSR;
+	std::vector<size_t> ptr;
+	std::vector<size_t> idx;
+	std::vector<_Td> vals;
+
+	size_t _Majors() const
+	{
+		return format == SparseFormat::CSR ? n_rows : n_cols;
+	}
+	/**
+	 * Sort the entries of each row (column) by index and add up the duplicates.
+	 */
+	void _Normalize()
+	{
+		std::vector<std::pair<size_t, _Td>> line;
+		size_t out = 0;
+		for (size_t m = 0; m < _Majors(); ++m) {
+			const size_t begin = ptr[m], end = ptr[m + 1];
+			line.clear();
+			for (size_t p = begin; p < end; ++p) {
+				line.emplace_back(idx[p], vals[p]);
+			}
+			std::stable_sort(line.begin(), line.end(),
+				[](const std::pair<size_t, _Td> &a, const std::pair<size_t, _Td> &b) { return a.first < b.first; });
+			ptr[m] = out;
+			for (size_t p = 0; p < line.size(); ++p) {
+				if (out > ptr[m] && idx[out - 1] == line[p].first) {
+					vals[out - 1] = vals[out - 1] + line[p].second;
+				}
+				else {
+					idx[out] = line[p].first;
+					vals[out] = line[p].second;
+					++out;
+				}
+			}
+		}
+		ptr[_Majors()] = out;
+		idx.resize(out);
+		vals.resize(out);
+	}
+public:
+	SparseMatrix() {}
+	/**
+	 * An all-zero matrix.
+	 */
+	SparseMatrix(const size_t &_n_rows, const size_t &_n_cols, const SparseFormat &_format = SparseFormat::CSR)
+		: n_rows(_n_rows), n_cols(_n_cols), format(_format), ptr(_Majors() + 1, 0) {}
+	/**
+	 * The elements given as (row, col, value), in any order. Values given for the same position are added.
+	 */
+	SparseMatrix(const size_t &_n_rows, const size_t &_n_cols, const std::vector<SparseTriplet<_Td>> &triplets,
+		const SparseFormat &_format = SparseFormat::CSR)
+		: SparseMatrix(_n_rows, _n_cols, _format)
+	{
+		const bool csr = format == SparseFormat::CSR;
+		for (const SparseTriplet<_Td> &t : triplets) {
+			if (t.row >= n_rows || t.col >= n_cols) {
+				throw std::out_of_range("the triplet is out of the matrix");
+			}
+			++ptr[(csr ? t.row : t.col) + 1];
+		}
+		for (size_t m = 0; m < _Majors(); ++m) {
+			ptr[m + 1] += ptr[m];
+		}
+		idx.resize(triplets.size());
+		vals.resize(triplets.size());
+		std::vector<size_t> next(ptr.begin(), ptr.end() - 1);
+		for (const SparseTriplet<_Td> &t : triplets) {
+			const size_t p = next[csr ? t.row : t.col]++;
+			idx[p] = csr ? t.col : t.row;
+			vals[p] = t.value;
+		}
+		_Normalize();
+	}
+	/**
+	 * Take the arrays of a matrix already in the given format, see the class comment.
+	 * Only their sizes are checked.
+	 */
+	SparseMatrix(const size_t &_n_rows, const size_t &_n_cols, const SparseFormat &_format,
+		std::vector<size_t> _ptr, std::vector<size_t> _idx, std::vector<_Td> _vals)
+		: n_rows(_n_rows), n_cols(_n_cols), format(_format), ptr(std::move(_ptr)), idx(std::move(_idx)), vals(std::move(_vals))
+	{
+		if (ptr.size() != _Majors() + 1 || ptr.back() != idx.size() || idx.size() != vals.size()) {
+			throw std::invalid_argument("the sparse arrays do not match the matrix");
+		}
+	}
+	/**
+	 * The elements of a dense matrix that are not equal to _Td().
+	 */
+	template<typename _Ex>
+	explicit SparseMatrix(const MatrixExpr<_Td, _Ex> &expr, const SparseFormat &_format = SparseFormat::CSR)
+		: SparseMatrix(expr.RowSize(), expr.ColSize(), _format)
+	{
+		const _Ex &e = expr.derived();
+		const bool csr = format == SparseFormat::CSR;
+		const size_t majors = _Majors(), minors = csr ? n_cols : n_rows;
+		for (size_t m = 0; m < majors; ++m) {
+			for (size_t k = 0; k < minors; ++k) {
+				const _Td &v = csr ? e(m, k) : e(k, m);
+				if (!(v == _Td())) {
+					idx.push_back(k);
+					vals.push_back(v);
+				}
+			}
+			ptr[m + 1] = idx.size();
+		}
+	}
+
+	size_t RowSize() const
+	{
+		return n_rows;
+	}
+	size_t ColSize() const
+	{
+		return n_cols;
+	}
+	size_t NonZeros() const
+	{
+		return vals.size();
+	}
+	SparseFormat Format() const
+	{
+		return format;
+	}
+	const std::vector<size_t> & Pointers() const
+	{
+		return ptr;
+	}
+	const std::vector<size_t> & Indices() const
+	{
+		return idx;
+	}
+	const std::vector<_Td> & Values() const
+	{
+		return vals;
+	}
+	/**
+	 * The element at (i, j), _Td() if it is not stored.
+	 */
+	_Td operator()(const size_t &i, const size_t &j) const
+	{
+		const bool csr = format == SparseFormat::CSR;
+		const size_t m = csr ? i : j, k = csr ? j : i;
+		const auto begin = idx.begin() + ptr[m], end = idx.begin() + ptr[m + 1];
+		const auto pos = std::lower_bound(begin, end, k);
+		return pos != end && *pos == k ? vals[pos - idx.begin()] : _Td();
+	}
+	/**
+	 * The same matrix stored in the other format, a transposition of the index arrays.
+	 */
+	SparseMatrix<_Td> Convert(const SparseFormat &_format) const
+	{
+		if (_format == format) {
+			return *this;
+		}
+		SparseMatrix<_Td> res(n_rows, n_cols, _format);
+		const size_t majors = res._Majors();
+		for (size_t p = 0; p < idx.size(); ++p) {
+			++res.ptr[idx[p] + 1];
+		}
+		for (size_t m = 0; m < majors; ++m) {
+			res.ptr[m + 1] += res.ptr[m];
+		}
+		res.idx.resize(idx.size());
+		res.vals.resize(vals.size());
+		std::vector<size_t> next(res.ptr.begin(), res.ptr.end() - 1);
+		for (size_t m = 0; m < _Majors(); ++m) {
+			for (size_t p = ptr[m]; p < ptr[m + 1]; ++p) {
+				const size_t q = next[idx[p]]++;
+				res.idx[q] = m;
+				res.vals[q] = vals[p];
+			}
+		}
+		return res;
+	}
+	Matrix<_Td> Dense() const
+	{
+		Matrix<_Td> res(n_rows, n_cols, _Td());
+		const bool csr = format == SparseFormat::CSR;
+		for (size_t m = 0; m < _Majors(); ++m) {
+			for (size_t p = ptr[m]; p < ptr[m + 1]; ++p) {
+				(csr ? res(m, idx[p]) : res(idx[p], m)) = vals[p];
+			}
+		}
+		return res;
+	}
+};
+
+/**
+ * y = A x, x has A.ColSize() elements and y A.RowSize(); y must not overlap x.
+ */
+template<typename _Td>
+void MultiplyInto(_Td *y, const SparseMatrix<_Td> &A, const _Td *x)
+{
+	const std::vector<size_t> &ptr = A.Pointers(), &idx = A.Indices();
+	const std::vector<_Td> &vals = A.Values();
+	if (A.Format() == SparseFormat::CSR) {
+		Kernel::ParallelNonZeros(ptr, 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				_Td sum = _Td();
+				for (size_t p = ptr[i]; p < ptr[i + 1]; ++p) {
+					sum = sum + vals[p] * x[idx[p]];
+				}
+				y[i] = sum;
+			}
+		});
+		return;
+	}
+	std::fill(y, y + A.RowSize(), _Td());
+	for (size_t j = 0; j < A.ColSize(); ++j) {
+		const _Td xj = x[j];
+		for (size_t p = ptr[j]; p < ptr[j + 1]; ++p) {
+			y[idx[p]] = y[idx[p]] + vals[p] * xj;
+		}
+	}
+}
+
+template<typename _Td>
+std::vector<_Td> operator*(const SparseMatrix<_Td> &A, const std::vector<_Td> &x)
+{
+	if (A.ColSize() != x.size()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	std::vector<_Td> y(A.RowSize());
+	MultiplyInto(y.data(), A, x.data());
+	return y;
+}
+
+/**
+ * C = A B with a dense B. Each non-zero a(i, k) adds a(i, k) times row k of B to row i of C.
+ */
+template<typename _Td, typename _Ex>
+Matrix<_Td> operator*(const SparseMatrix<_Td> &A, const MatrixExpr<_Td, _Ex> &b)
+{
+	if (A.ColSize() != b.RowSize()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	Matrix<_Td> storage;
+	const GemmOperand<_Td> B = _ProductOperand(b.derived(), storage);
+	const size_t n = B.cols;
+	Matrix<_Td> C(A.RowSize(), n, _Td());
+	const std::vector<size_t> &ptr = A.Pointers(), &idx = A.Indices();
+	const std::vector<_Td> &vals = A.Values();
+	auto axpy = [&](const size_t &i, const _Td &a, const size_t &k) {
+		_Td *ci = C[i];
+		for (size_t j = 0; j < n; ++j) {
+			ci[j] = ci[j] + a * B(k, j);
+		}
+	};
+	if (A.Format() == SparseFormat::CSR) {
+		Kernel::ParallelNonZeros(ptr, n, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				for (size_t p = ptr[i]; p < ptr[i + 1]; ++p) {
+					axpy(i, vals[p], idx[p]);
+				}
+			}
+		});
+	}
+	else {
+		for (size_t k = 0; k < A.ColSize(); ++k) {
+			for (size_t p = ptr[k]; p < ptr[k + 1]; ++p) {
+				axpy(idx[p], vals[p], k);
+			}
+		}
+	}
+	return C;
+}
+
+template<typename _Td, typename _Op>
+SparseMatrix<_Td> _SparseMerge(const SparseMatrix<_Td> &a, const SparseMatrix<_Td> &b, const _Op &op)
+{
+	if (a.RowSize() != b.RowSize() || a.ColSize() != b.ColSize()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	SparseMatrix<_Td> converted;
+	const SparseMatrix<_Td> &B = b.Format() == a.Format() ? b : (converted = b.Convert(a.Format()));
+	const size_t majors = a.Format() == SparseFormat::CSR ? a.RowSize() : a.ColSize();
+	const std::vector<size_t> &pa = a.Pointers(), &ia = a.Indices(), &pb = B.Pointers(), &ib = B.Indices();
+	const std::vector<_Td> &va = a.Values(), &vb = B.Values();
+	std::vector<size_t> ptr(majors + 1, 0), idx;
+	std::vector<_Td> vals;
+	idx.reserve(ia.size() + ib.size());
+	vals.reserve(ia.size() + ib.size());
+	for (size_t m = 0; m < majors; ++m) {
+		size_t p = pa[m], q = pb[m];
+		while (p < pa[m + 1] || q < pb[m + 1]) {
+			size_t k;
+			_Td v;
+			if (q == pb[m + 1] || (p < pa[m + 1] && ia[p] < ib[q])) {
+				k = ia[p];
+				v = op(va[p], _Td());
+				++p;
+			}
+			else if (p == pa[m + 1] || ib[q] < ia[p]) {
+				k = ib[q];
+				v = op(_Td(), vb[q]);
+				++q;
+			}
+			else {
+				k = ia[p];
+				v = op(va[p], vb[q]);
+				++p, ++q;
+			}
+			// entries that cancel are not stored, as in the constructor from a dense matrix
+			if (!(v == _Td())) {
+				idx.push_back(k);
+				vals.push_back(v);
+			}
+		}
+		ptr[m + 1] = idx.size();
+	}
+	return SparseMatrix<_Td>(a.RowSize(), a.ColSize(), a.Format(), std::move(ptr), std::move(idx), std::move(vals));
+}
+
+/**
+ * Sum and difference of two sparse matrics, in the format of the left one.
+ */
+template<typename _Td>
+SparseMatrix<_Td> operator+(const SparseMatrix<_Td> &a, const SparseMatrix<_Td> &b)
+{
+	return _SparseMerge(a, b, [](const _Td &x, const _Td &y) { return x + y; });
+}
+
+template<typename _Td>
+SparseMatrix<_Td> operator-(const SparseMatrix<_Td> &a, const SparseMatrix<_Td> &b)
+{
+	return _SparseMerge(a, b, [](const _Td &x, const _Td &y) { return x - y; });
+}
+
+}
+#endif
@@ -0,0 +1,459 @@
+#ifndef DIAMOND_MATRIX_BATCH_HPP
+#define DIAMOND_MATRIX_BATCH_HPP
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "matrix-thread.hpp"
+#include "matrix-gemm.hpp"
+#include "matrix-expr.hpp"
+
+namespace Diamond {
+
+/**
+ * Many products of small matrices of the same shapes at once.
+ *
+ * Strided: matrix b of the batch starts at b * stride, row-major with its own leading
+ * dimension, so each one can be read as a Matrix would. Products up to about 32 x 32 are
+ * computed in place by tiles of rows whose sums stay in registers, larger ones by Gemm,
+ * which would spend longer packing a small matrix than multiplying it.
+ * Interleaved: the matrices are grouped in packs of BatchLanes<_Td>(), the last pack
+ * padded, and element (i, j) of the matrices of a pack are stored next to each other, at
+ * ((pack * rows + i) * cols + j) * lanes + b % lanes. The innermost loop runs across the
+ * pack, so matrices of any size, down to 2 x 2, fill whole vector registers, and a pack
+ * is as compact as one matrix of lanes-wide elements. It pays off up to about 16 x 16;
+ * above that a pack is split into row-major matrices for Gemm and put back, which is
+ * still slower than a strided batch.
+ *
+ * The batch is split between the threads of Kernel::Pool(). A product with one column
+ * on the right is a matrix-vector product; strided batches compute it as dot products.
+ */
+enum class BatchLayout { Strided, Interleaved };
+
+namespace Kernel {
+
+/**
+ * Strided products with at most this many multiply-adds skip Gemm.
+ */
+const size_t BATCH_DIRECT_MNK = 32 * 32 * 32;
+
+/**
+ * Interleaved products with more multiply-adds than this go through Gemm a matrix at a time.
+ */
+const size_t BATCH_INTERLEAVED_MNK = 16 * 16 * 16;
+
+/**
+ * Bytes of one element of every matrix of an interleaved pack: a vector register.
+ */
+const size_t BATCH_LANE_BYTES = 64;
+
+/**
+ * Columns of the product computed together for a pack, BATCH_TILE_COLS vectors of sums.
+ */
+const size_t BATCH_TILE_COLS = 8;
+
+/**
+ * Rows of a strided product computed together, against one or two vectors of columns.
+ */
+const size_t BATCH_TILE_ROWS = 4;
+
+/**
+ * Matrices per pack of an interleaved batch, and elements of one vector register.
+ */
+template<typename _Td>
+constexpr size_t BatchLanes()
+{
+	return GemmSupported<_Td>::value ? std::max<size_t>(BATCH_LANE_BYTES / sizeof(_Td), 1) : 1;
+}
+
+/**
+ * Rows [0, R) and columns [0, W) of one strided product, a points at the first of the rows of A
+ * and b at the first of the columns of B. The R x W sums stay in registers while k runs.
+ */
+template<typename _Td, size_t R, size_t W>
+__attribute__((noinline)) void _BatchRowTile(const size_t &K, const _Td &alpha, const _Td *a, const size_t &lda,
+	const _Td *b, const size_t &ldb, const _Td &beta, _Td *c, const size_t &ldc)
+{
+	_Td acc[R][W] = {};
+	for (size_t k = 0; k < K; ++k) {
+		const _Td *bk = b + k * ldb;
+		for (size_t r = 0; r < R; ++r) {
+			const _Td ark = a[r * lda + k];
+			for (size_t w = 0; w < W; ++w) {
+				acc[r][w] = acc[r][w] + ark * bk[w];
+			}
+		}
+	}
+	for (size_t r = 0; r < R; ++r) {
+		for (size_t w = 0; w < W; ++w) {
+			_Td &cw = c[r * ldc + w];
+			cw = beta == _Td(0) ? alpha * acc[r][w] : alpha * acc[r][w] + beta * cw;
+		}
+	}
+}
+
+template<typename _Td, size_t R>
+void _BatchRows(const size_t &N, const size_t &K, const _Td &alpha, const _Td *a, const size_t &lda,
+	const _Td *B, const size_t &ldb, const _Td &beta, _Td *c, const size_t &ldc)
+{
+	const size_t W = BatchLanes<_Td>();
+	size_t j = 0;
+	for (; j + 2 * W <= N; j += 2 * W) {
+		_BatchRowTile<_Td, R, 2 * BatchLanes<_Td>()>(K, alpha, a, lda, B + j, ldb, beta, c + j, ldc);
+	}
+	if (j + W <= N) {
+		_BatchRowTile<_Td, R, BatchLanes<_Td>()>(K, alpha, a, lda, B + j, ldb, beta, c + j, ldc);
+		j += W;
+	}
+	for (; j < N; ++j) {
+		_BatchRowTile<_Td, R, 1>(K, alpha, a, lda, B + j, ldb, beta, c + j, ldc);
+	}
+}
+
+template<typename _Td>
+void _BatchGemmDirect(const size_t &M, const size_t &N, const size_t &K, const _Td &alpha,
+	const _Td *A, const size_t &lda, const _Td *B, const size_t &ldb, const _Td &beta, _Td *C, const size_t &ldc)
+{
+	if (N == 1) {
+		for (size_t i = 0; i < M; ++i) {
+			const _Td *ai = A + i * lda;
+			// four partial sums so that the dot product is not one chain of additions
+			_Td s0 = _Td(), s1 = _Td(), s2 = _Td(), s3 = _Td();
+			size_t k = 0;
+			for (; k + 4 <= K; k += 4) {
+				s0 = s0 + ai[k] * B[k * ldb];
+				s1 = s1 + ai[k + 1] * B[(k + 1) * ldb];
+				s2 = s2 + ai[k + 2] * B[(k + 2) * ldb];
+				s3 = s3 + ai[k + 3] * B[(k + 3) * ldb];
+			}
+			for (; k < K; ++k) {
+				s0 = s0 + ai[k] * B[k * ldb];
+			}
+			const _Td sum = (s0 + s1) + (s2 + s3);
+			C[i * ldc] = beta == _Td(0) ? alpha * sum : alpha * sum + beta * C[i * ldc];
+		}
+		return;
+	}
+	if constexpr (GemmSupported<_Td>::value) {
+		size_t i = 0;
+		for (; i + BATCH_TILE_ROWS <= M; i += BATCH_TILE_ROWS) {
+			_BatchRows<_Td, BATCH_TILE_ROWS>(N, K, alpha, A + i * lda, lda, B, ldb, beta, C + i * ldc, ldc);
+		}
+		for (; i < M; ++i) {
+			_BatchRows<_Td, 1>(N, K, alpha, A + i * lda, lda, B, ldb, beta, C + i * ldc, ldc);
+		}
+		return;
+	}
+	for (size_t i = 0; i < M; ++i) {
+		_Td *ci = C + i * ldc;
+		for (size_t j = 0; j < N; ++j) {
+			ci[j] = beta == _Td(0) ? _Td() : beta * ci[j];
+		}
+		for (size_t k = 0; k < K; ++k) {
+			const _Td a = alpha * A[i * lda + k];
+			const _Td *bk = B + k * ldb;
+			for (size_t j = 0; j < N; ++j) {
+				ci[j] = ci[j] + a * bk[j];
+			}
+		}
+	}
+}
+
+/**
+ * C_b = alpha * A_b * B_b + beta * C_b for b < count, C_b (M x N) at C + b * strideC and so on.
+ * When beta is 0, C is overwritten without being read.
+ */
+template<typename _Td>
+void BatchGemm(const size_t &count, const size_t &M, const size_t &N, const size_t &K, const _Td &alpha,
+	const _Td *A, const size_t &lda, const size_t &strideA,
+	const _Td *B, const size_t &ldb, const size_t &strideB,
+	const _Td &beta, _Td *C, const size_t &ldc, const size_t &strideC)
+{
+	const bool direct = N == 1 || M * N * K <= BATCH_DIRECT_MNK;
+	ParallelRows(count, std::max<size_t>(M * N * K, 1), [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; ++b) {
+			const _Td *a = A + b * strideA, *x = B + b * strideB;
+			_Td *c = C + b * strideC;
+			if constexpr (GemmSupported<_Td>::value) {
+				if (!direct) {
+					Gemm<_Td>(M, N, K, alpha, a, lda, 1, x, ldb, 1, beta, c, ldc);
+					continue;
+				}
+			}
+			_BatchGemmDirect(M, N, K, alpha, a, lda, x, ldb, beta, c, ldc);
+		}
+	});
+}
+
+/**
+ * Columns [j, j + W) of row i of the products of a pack of L matrices, a points at row i
+ * of the A of the pack and b at column j of its B. The W x L sums stay in registers while
+ * k runs, so a row of A is loaded once for W columns.
+ * Not inlined: inside the loops of the pack GCC does not keep the sums in registers.
+ */
+template<typename _Td, size_t L, size_t W>
+__attribute__((noinline)) void _BatchTile(const size_t &K, const size_t &N, const _Td &alpha,
+	const _Td *a, const _Td *b, const _Td &beta, _Td *c)
+{
+	_Td acc[W][L] = {};
+	for (size_t k = 0; k < K; ++k) {
+		const _Td *ak = a + k * L, *bk = b + k * N * L;
+		for (size_t u = 0; u < W; ++u) {
+			for (size_t l = 0; l < L; ++l) {
+				acc[u][l] = acc[u][l] + ak[l] * bk[u * L + l];
+			}
+		}
+	}
+	for (size_t u = 0; u < W; ++u) {
+		for (size_t l = 0; l < L; ++l) {
+			c[u * L + l] = beta == _Td(0) ? alpha * acc[u][l] : alpha * acc[u][l] + beta * c[u * L + l];
+		}
+	}
+}
+
+template<typename _Td, size_t L>
+void _BatchGemmPack(const size_t &M, const size_t &N, const size_t &K, const _Td &alpha,
+	const _Td *A, const _Td *B, const _Td &beta, _Td *C)
+{
+	const size_t W = BATCH_TILE_COLS;
+	for (size_t i = 0; i < M; ++i) {
+		size_t j = 0;
+		for (; j + W <= N; j += W) {
+			_BatchTile<_Td, L, BATCH_TILE_COLS>(K, N, alpha, A + i * K * L, B + j * L, beta, C + (i * N + j) * L);
+		}
+		for (; j < N; ++j) {
+			_BatchTile<_Td, L, 1>(K, N, alpha, A + i * K * L, B + j * L, beta, C + (i * N + j) * L);
+		}
+	}
+}
+
+/**
+ * The products of the first lanes matrices of a pack by Gemm, one at a time: the pack is first
+ * split into row-major matrices in a buffer kept by the thread, in one pass, and the products
+ * are put back in one pass.
+ */
+template<typename _Td>
+void _BatchGemmLanes(const size_t &lanes, const size_t &M, const size_t &N, const size_t &K, const _Td &alpha,
+	const _Td *A, const _Td *B, const _Td &beta, _Td *C)
+{
+	const size_t L = BatchLanes<_Td>();
+	static thread_local std::vector<_Td> split;
+	split.resize((M * K + K * N + M * N) * lanes);
+	_Td *a = split.data(), *b = a + M * K * lanes, *c = b + K * N * lanes;
+	for (size_t e = 0; e < M * K; ++e) {
+		for (size_t l = 0; l < lanes; ++l) {
+			a[l * M * K + e] = A[e * L + l];
+		}
+	}
+	for (size_t e = 0; e < K * N; ++e) {
+		for (size_t l = 0; l < lanes; ++l) {
+			b[l * K * N + e] = B[e * L + l];
+		}
+	}
+	if (beta != _Td(0)) {
+		for (size_t e = 0; e < M * N; ++e) {
+			for (size_t l = 0; l < lanes; ++l) {
+				c[l * M * N + e] = C[e * L + l];
+			}
+		}
+	}
+	for (size_t l = 0; l < lanes; ++l) {
+		Gemm<_Td>(M, N, K, alpha, a + l * M * K, static_cast<std::ptrdiff_t>(K), 1,
+			b + l * K * N, static_cast<std::ptrdiff_t>(N), 1, beta, c + l * M * N, N);
+	}
+	for (size_t e = 0; e < M * N; ++e) {
+		for (size_t l = 0; l < lanes; ++l) {
+			C[e * L + l] = c[l * M * N + e];
+		}
+	}
+}
+
+/**
+ * The same for interleaved batches, padding lanes included up to BATCH_INTERLEAVED_MNK.
+ */
+template<typename _Td>
+void BatchGemmInterleaved(const size_t &count, const size_t &M, const size_t &N, const size_t &K, const _Td &alpha,
+	const _Td *A, const _Td *B, const _Td &beta, _Td *C)
+{
+	const size_t L = BatchLanes<_Td>(), packs = (count + L - 1) / L;
+	const bool byGemm = M * N * K > BATCH_INTERLEAVED_MNK;
+	ParallelRows(packs, std::max<size_t>(M * N * K * L, 1), [&](size_t begin, size_t end) {
+		for (size_t p = begin; p < end; ++p) {
+			const _Td *a = A + p * M * K * L, *b = B + p * K * N * L;
+			_Td *c = C + p * M * N * L;
+			if constexpr (GemmSupported<_Td>::value) {
+				if (byGemm) {
+					_BatchGemmLanes(std::min(L, count - p * L), M, N, K, alpha, a, b, beta, c);
+					continue;
+				}
+			}
+			_BatchGemmPack<_Td, BatchLanes<_Td>()>(M, N, K, alpha, a, b, beta, c);
+		}
+	});
+}
+
+}
+
+/**
+ * count matrices of rows x cols in one buffer, see the top of this file for the layouts.
+ */
+template<typename _Td>
+class MatrixBatch {
+	static_assert(!std::is_same<_Td, bool>::value, "a batch of bool is not supported");
+
+	size_t n_count = 0;
+	size_t n_rows = 0;
+	size_t n_cols = 0;
+	BatchLayout layout = BatchLayout::Strided;
+	std::vector<_Td> elems;
+
+	static size_t _Padded(const size_t &count, const BatchLayout &layout)
+	{
+		const size_t L = Kernel::BatchLanes<_Td>();
+		return layout == BatchLayout::Strided ? count : (count + L - 1) / L * L;
+	}
+	size_t _Index(const size_t &b, const size_t &i, const size_t &j) const
+	{
+		if (layout == BatchLayout::Strided) {
+			return (b * n_rows + i) * n_cols + j;
+		}
+		const size_t L = Kernel::BatchLanes<_Td>();
+		return ((b / L * n_rows + i) * n_cols + j) * L + b % L;
+	}
+public:
+	MatrixBatch() {}
+	MatrixBatch(const size_t &_n_count, const size_t &_n_rows, const size_t &_n_cols,
+		const BatchLayout &_layout = BatchLayout::Strided, const _Td &fillValue = _Td())
+		: n_count(_n_count), n_rows(_n_rows), n_cols(_n_cols), layout(_layout),
+		elems(_Padded(_n_count, _layout) * _n_rows * _n_cols, fillValue)
+	{
+		// the padding of the last pack is multiplied like the rest, keep it at zero
+		for (size_t b = n_count; b < _Padded(n_count, layout); ++b) {
+			for (size_t i = 0; i < n_rows; ++i) {
+				for (size_t j = 0; j < n_cols; ++j) {
+					(*this)(b, i, j) = _Td();
+				}
+			}
+		}
+	}
+
+	size_t Count() const
+	{
+		return n_count;
+	}
+	size_t RowSize() const
+	{
+		return n_rows;
+	}
+	size_t ColSize() const
+	{
+		return n_cols;
+	}
+	BatchLayout Layout() const
+	{
+		return layout;
+	}
+	_Td * data()
+	{
+		return elems.data();
+	}
+	const _Td * data() const
+	{
+		return elems.data();
+	}
+	_Td & operator()(const size_t &b, const size_t &i, const size_t &j)
+	{
+		return elems[_Index(b, i, j)];
+	}
+	const _Td & operator()(const size_t &b, const size_t &i, const size_t &j) const
+	{
+		return elems[_Index(b, i, j)];
+	}
+	/**
+	 * A copy of matrix b.
+	 */
+	Matrix<_Td> Get(const size_t &b) const
+	{
+		Matrix<_Td> res(n_rows, n_cols);
+		for (size_t i = 0; i < n_rows; ++i) {
+			for (size_t j = 0; j < n_cols; ++j) {
+				res(i, j) = (*this)(b, i, j);
+			}
+		}
+		return res;
+	}
+	template<typename _Ex>
+	void Set(const size_t &b, const MatrixExpr<_Td, _Ex> &expr)
+	{
+		const _Ex &e = expr.derived();
+		if (e.RowSize() != n_rows || e.ColSize() != n_cols) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+		for (size_t i = 0; i < n_rows; ++i) {
+			for (size_t j = 0; j < n_cols; ++j) {
+				(*this)(b, i, j) = e(i, j);
+			}
+		}
+	}
+	MatrixBatch<_Td> Convert(const BatchLayout &_layout) const
+	{
+		MatrixBatch<_Td> res(n_count, n_rows, n_cols, _layout);
+		for (size_t b = 0; b < n_count; ++b) {
+			for (size_t i = 0; i < n_rows; ++i) {
+				for (size_t j = 0; j < n_cols; ++j) {
+					res(b, i, j) = (*this)(b, i, j);
+				}
+			}
+		}
+		return res;
+	}
+};
+
+/**
+ * c_b = alpha * a_b * b_b + beta * c_b for every matrix of the batches, which share a layout.
+ */
+template<typename _Td>
+void MultiplyAdd(MatrixBatch<_Td> &c, const MatrixBatch<_Td> &a, const MatrixBatch<_Td> &b,
+	const _Td &alpha = _Td(1), const _Td &beta = _Td(1))
+{
+	if (a.Count() != b.Count() || a.ColSize() != b.RowSize()
+		|| c.Count() != a.Count() || c.RowSize() != a.RowSize() || c.ColSize() != b.ColSize()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	if (a.Layout() != b.Layout() || c.Layout() != a.Layout()) {
+		throw std::invalid_argument("different batch layouts");
+	}
+	const size_t M = a.RowSize(), N = b.ColSize(), K = a.ColSize();
+	if (a.Layout() == BatchLayout::Strided) {
+		Kernel::BatchGemm(a.Count(), M, N, K, alpha, a.data(), K, M * K, b.data(), N, K * N, beta, c.data(), N, M * N);
+	}
+	else {
+		Kernel::BatchGemmInterleaved(a.Count(), M, N, K, alpha, a.data(), b.data(), beta, c.data());
+	}
+}
+
+/**
+ * c_b = a_b * b_b, c takes the shape and layout of the products.
+ * With one column in b this is a batch of matrix-vector products.
+ */
+template<typename _Td>
+void MultiplyInto(MatrixBatch<_Td> &c, const MatrixBatch<_Td> &a, const MatrixBatch<_Td> &b)
+{
+	if (c.Count() != a.Count() || c.RowSize() != a.RowSize() || c.ColSize() != b.ColSize() || c.Layout() != a.Layout()) {
+		c = MatrixBatch<_Td>(a.Count(), a.RowSize(), b.ColSize(), a.Layout());
+	}
+	MultiplyAdd(c, a, b, _Td(1), _Td(0));
+}
+
+template<typename _Td>
+MatrixBatch<_Td> operator*(const MatrixBatch<_Td> &a, const MatrixBatch<_Td> &b)
+{
+	MatrixBatch<_Td> c;
+	MultiplyInto(c, a, b);
+	return c;
+}
+
+}
+#endif
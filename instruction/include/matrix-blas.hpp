@@ -0,0 +1,395 @@
+#ifndef DIAMOND_MATRIX_BLAS_HPP
+#define DIAMOND_MATRIX_BLAS_HPP
+
+#include <vector>
+#include <stdexcept>
+#include <cstddef>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+#include "matrix-thread.hpp"
+#include "class-matrix.hpp"
+
+namespace Diamond {
+
+/**
+ * Matrix-vector products and vector operations, the kernels iterative solvers spend their time in.
+ *
+ * Vectors are contiguous: pointers or std::vector. Gemv computes y = alpha A x + beta y,
+ * reading A in place when it is a matrix or a view; a transposed view, or GemvTransposed,
+ * goes through rows of A instead of columns. Axpy, Dot and Nrm2 also take two matrices of
+ * the same shape, element by element, and Nrm2 of a matrix is its Frobenius norm.
+ *
+ * Sums run in several independent accumulators, which the compiler keeps in vector
+ * registers; the result may differ from a left-to-right sum in the last bits.
+ * Long vectors and tall matrices are split between the threads of Kernel::Pool().
+ * Dot splits a vector in blocks of a fixed length, not per thread, so its result does
+ * not depend on the number of threads.
+ */
+namespace Kernel {
+
+/**
+ * Bytes of partial sums kept by Dot and by each row of Gemv: a few vector registers.
+ */
+const size_t BLAS_LANE_BYTES = 128;
+
+/**
+ * Dot sums blocks of this many elements separately and then adds the block sums in order.
+ */
+const size_t BLAS_DOT_BLOCK = PARALLEL_MIN_ELEMS;
+
+template<typename _Td>
+constexpr size_t BlasLanes()
+{
+	return std::is_arithmetic<_Td>::value ? std::max<size_t>(BLAS_LANE_BYTES / sizeof(_Td), 1) : 1;
+}
+
+/**
+ * The L partial sums of a row, added pairwise.
+ */
+template<typename _Td, size_t L>
+_Td _BlasSum(const _Td *acc)
+{
+	if constexpr (L == 1) {
+		return acc[0];
+	}
+	else {
+		return _BlasSum<_Td, L / 2>(acc) + _BlasSum<_Td, L - L / 2>(acc + L / 2);
+	}
+}
+
+template<typename _Td>
+_Td _DotBlock(const size_t &n, const _Td *x, const _Td *y)
+{
+	const size_t L = BlasLanes<_Td>();
+	_Td acc[L] = {};
+	size_t k = 0;
+	for (; k + L <= n; k += L) {
+		for (size_t l = 0; l < L; ++l) {
+			acc[l] = acc[l] + x[k + l] * y[k + l];
+		}
+	}
+	for (size_t l = 0; k < n; ++k, ++l) {
+		acc[l] = acc[l] + x[k] * y[k];
+	}
+	return _BlasSum<_Td, L>(acc);
+}
+
+/**
+ * x . y for vectors of length n.
+ */
+template<typename _Td>
+_Td Dot(const size_t &n, const _Td *x, const _Td *y)
+{
+	if (n <= BLAS_DOT_BLOCK) {
+		return _DotBlock(n, x, y);
+	}
+	const size_t blocks = (n + BLAS_DOT_BLOCK - 1) / BLAS_DOT_BLOCK;
+	std::vector<_Td> sums(blocks);
+	ParallelRows(blocks, BLAS_DOT_BLOCK, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; ++b) {
+			const size_t k = b * BLAS_DOT_BLOCK;
+			sums[b] = _DotBlock(std::min(BLAS_DOT_BLOCK, n - k), x + k, y + k);
+		}
+	});
+	_Td sum = _Td();
+	for (size_t b = 0; b < blocks; ++b) {
+		sum = sum + sums[b];
+	}
+	return sum;
+}
+
+/**
+ * y += alpha x for vectors of length n.
+ */
+template<typename _Td>
+void Axpy(const size_t &n, const _Td &alpha, const _Td *x, _Td *y)
+{
+	ParallelRows(n, 1, [&](size_t begin, size_t end) {
+		for (size_t k = begin; k < end; ++k) {
+			y[k] = y[k] + alpha * x[k];
+		}
+	});
+}
+
+/**
+ * The Euclidean norm of x. The squares are summed as they are; only when the sum
+ * overflows or is so small that it lost precision, x is summed again scaled by its
+ * largest element.
+ */
+template<typename _Td>
+_Td Nrm2(const size_t &n, const _Td *x)
+{
+	static_assert(std::is_floating_point<_Td>::value, "Nrm2 needs a floating point element type");
+	const _Td sum = Dot(n, x, x);
+	if (sum <= std::numeric_limits<_Td>::max() && sum >= std::numeric_limits<_Td>::min() / std::numeric_limits<_Td>::epsilon()) {
+		return std::sqrt(sum);
+	}
+	_Td scale = _Td();
+	for (size_t k = 0; k < n; ++k) {
+		scale = std::max(scale, std::abs(x[k]));
+	}
+	if (scale == _Td(0)) {
+		return scale;
+	}
+	if (std::isinf(scale) || std::isnan(sum)) {
+		return sum;
+	}
+	// divided, not multiplied by 1 / scale, which overflows for a subnormal scale
+	_Td acc = _Td();
+	for (size_t k = 0; k < n; ++k) {
+		const _Td v = x[k] / scale;
+		acc = acc + v * v;
+	}
+	return scale * std::sqrt(acc);
+}
+
+/**
+ * Rows [0, R) of A x, the L partial sums of each row in registers and x loaded once for the R rows.
+ * Not inlined, so that GCC keeps the R x L sums in registers.
+ */
+template<typename _Td, size_t R>
+__attribute__((noinline)) void _GemvRows(const size_t &N, const _Td *A, const size_t &lda, const _Td *x, _Td *dots)
+{
+	const size_t L = BlasLanes<_Td>() / 2 ? BlasLanes<_Td>() / 2 : 1;
+	_Td acc[R][L] = {};
+	size_t k = 0;
+	for (; k + L <= N; k += L) {
+		for (size_t r = 0; r < R; ++r) {
+			const _Td *ar = A + r * lda + k;
+			for (size_t l = 0; l < L; ++l) {
+				acc[r][l] = acc[r][l] + ar[l] * x[k + l];
+			}
+		}
+	}
+	for (size_t r = 0; r < R; ++r) {
+		_Td tail = _Td();
+		for (size_t j = k; j < N; ++j) {
+			tail = tail + A[r * lda + j] * x[j];
+		}
+		dots[r] = _BlasSum<_Td, L>(acc[r]) + tail;
+	}
+}
+
+/**
+ * y = alpha A x + beta y, A (M x N) row-major with leading dimension lda.
+ * When beta is 0, y is overwritten without being read.
+ */
+template<typename _Td>
+void Gemv(const size_t &M, const size_t &N, const _Td &alpha, const _Td *A, const size_t &lda,
+	const _Td *x, const _Td &beta, _Td *y)
+{
+	const size_t R = 4;
+	auto store = [&](const size_t &i, const _Td &dot) {
+		y[i] = beta == _Td(0) ? alpha * dot : alpha * dot + beta * y[i];
+	};
+	ParallelRows(M, N, [&](size_t begin, size_t end) {
+		_Td dots[R];
+		size_t i = begin;
+		for (; i + R <= end; i += R) {
+			_GemvRows<_Td, R>(N, A + i * lda, lda, x, dots);
+			for (size_t r = 0; r < R; ++r) {
+				store(i + r, dots[r]);
+			}
+		}
+		for (; i < end; ++i) {
+			_GemvRows<_Td, 1>(N, A + i * lda, lda, x, dots);
+			store(i, dots[0]);
+		}
+	});
+}
+
+/**
+ * y = alpha A^T x + beta y, A (M x N) row-major: y (N) gets rows of A scaled by the
+ * elements of x, four rows per pass over y. The threads take slices of y.
+ */
+template<typename _Td>
+void GemvTransposed(const size_t &M, const size_t &N, const _Td &alpha, const _Td *A, const size_t &lda,
+	const _Td *x, const _Td &beta, _Td *y)
+{
+	ParallelRows(N, M, [&](size_t begin, size_t end) {
+		_Td *yb = y + begin;
+		const size_t w = end - begin;
+		for (size_t j = 0; j < w; ++j) {
+			yb[j] = beta == _Td(0) ? _Td() : beta * yb[j];
+		}
+		size_t i = 0;
+		for (; i + 4 <= M; i += 4) {
+			const _Td x0 = alpha * x[i], x1 = alpha * x[i + 1], x2 = alpha * x[i + 2], x3 = alpha * x[i + 3];
+			const _Td *a0 = A + i * lda + begin, *a1 = a0 + lda, *a2 = a1 + lda, *a3 = a2 + lda;
+			for (size_t j = 0; j < w; ++j) {
+				yb[j] = yb[j] + (x0 * a0[j] + x1 * a1[j]) + (x2 * a2[j] + x3 * a3[j]);
+			}
+		}
+		for (; i < M; ++i) {
+			const _Td xi = alpha * x[i];
+			const _Td *ai = A + i * lda + begin;
+			for (size_t j = 0; j < w; ++j) {
+				yb[j] = yb[j] + xi * ai[j];
+			}
+		}
+	});
+}
+
+}
+
+template<typename _Td>
+void _Gemv(const _Td &alpha, const GemmOperand<_Td> &a, const _Td *x, const _Td &beta, _Td *y)
+{
+	if (a.cs == 1) {
+		Kernel::Gemv(a.rows, a.cols, alpha, a.ptr, static_cast<size_t>(a.rs), x, beta, y);
+	}
+	else {
+		// a transposed view: a is the transpose of a row-major matrix with rows cs apart
+		Kernel::GemvTransposed(a.cols, a.rows, alpha, a.ptr, static_cast<size_t>(a.cs), x, beta, y);
+	}
+}
+
+/**
+ * y = alpha A x + beta y, x of length A.ColSize() and y of length A.RowSize().
+ * y must not overlap A or x.
+ */
+template<typename _Td, typename _Ex>
+void Gemv(const _Td &alpha, const MatrixExpr<_Td, _Ex> &A, const _Td *x, const _Td &beta, _Td *y)
+{
+	Matrix<_Td> storage;
+	_Gemv(alpha, _ProductOperand(A, storage), x, beta, y);
+}
+
+/**
+ * y = alpha A^T x + beta y, x of length A.RowSize() and y of length A.ColSize().
+ */
+template<typename _Td, typename _Ex>
+void GemvTransposed(const _Td &alpha, const MatrixExpr<_Td, _Ex> &A, const _Td *x, const _Td &beta, _Td *y)
+{
+	Matrix<_Td> storage;
+	const GemmOperand<_Td> a = _ProductOperand(A, storage);
+	_Gemv(alpha, GemmOperand<_Td>{a.ptr, a.cols, a.rows, a.cs, a.rs}, x, beta, y);
+}
+
+/**
+ * y = A x.
+ */
+template<typename _Td, typename _Ex>
+void MultiplyInto(_Td *y, const MatrixExpr<_Td, _Ex> &A, const _Td *x)
+{
+	Gemv(_Td(1), A, x, _Td(0), y);
+}
+
+template<typename _Td, typename _Ex>
+std::vector<_Td> operator*(const MatrixExpr<_Td, _Ex> &A, const std::vector<_Td> &x)
+{
+	if (A.derived().ColSize() != x.size()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	std::vector<_Td> y(A.derived().RowSize());
+	MultiplyInto(y.data(), A, x.data());
+	return y;
+}
+
+/**
+ * x^T A, the product of a row vector and a matrix.
+ */
+template<typename _Td, typename _Ex>
+std::vector<_Td> operator*(const std::vector<_Td> &x, const MatrixExpr<_Td, _Ex> &A)
+{
+	if (A.derived().RowSize() != x.size()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	std::vector<_Td> y(A.derived().ColSize());
+	GemvTransposed(_Td(1), A, x.data(), _Td(0), y.data());
+	return y;
+}
+
+/**
+ * y += alpha x.
+ */
+template<typename _Td>
+void Axpy(const _Td &alpha, const std::vector<_Td> &x, std::vector<_Td> &y)
+{
+	if (x.size() != y.size()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	Kernel::Axpy(x.size(), alpha, x.data(), y.data());
+}
+
+template<typename _Td>
+_Td Dot(const std::vector<_Td> &x, const std::vector<_Td> &y)
+{
+	if (x.size() != y.size()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	return Kernel::Dot(x.size(), x.data(), y.data());
+}
+
+template<typename _Td>
+_Td Nrm2(const std::vector<_Td> &x)
+{
+	return Kernel::Nrm2(x.size(), x.data());
+}
+
+/**
+ * Y += alpha X, row by row, rows split between the threads.
+ */
+template<typename _Td>
+void Axpy(const _Td &alpha, const Matrix<_Td> &X, Matrix<_Td> &Y)
+{
+	if (X.RowSize() != Y.RowSize() || X.ColSize() != Y.ColSize()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	const size_t cols = X.ColSize();
+	Kernel::ParallelRows(X.RowSize(), cols, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			const _Td *xi = X[i];
+			_Td *yi = Y[i];
+			for (size_t j = 0; j < cols; ++j) {
+				yi[j] = yi[j] + alpha * xi[j];
+			}
+		}
+	});
+}
+
+/**
+ * The sum of the products of the elements, the row sums added in order.
+ */
+template<typename _Td>
+_Td Dot(const Matrix<_Td> &X, const Matrix<_Td> &Y)
+{
+	if (X.RowSize() != Y.RowSize() || X.ColSize() != Y.ColSize()) {
+		throw std::invalid_argument("different matrics\'s sizes");
+	}
+	std::vector<_Td> rows(X.RowSize());
+	Kernel::ParallelRows(X.RowSize(), X.ColSize(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			rows[i] = Kernel::Dot(X.ColSize(), X[i], Y[i]);
+		}
+	});
+	_Td sum = _Td();
+	for (size_t i = 0; i < rows.size(); ++i) {
+		sum = sum + rows[i];
+	}
+	return sum;
+}
+
+/**
+ * The Frobenius norm.
+ */
+template<typename _Td>
+_Td Nrm2(const Matrix<_Td> &X)
+{
+	static_assert(std::is_floating_point<_Td>::value, "Nrm2 needs a floating point element type");
+	const _Td sum = Dot(X, X);
+	if (sum <= std::numeric_limits<_Td>::max() && sum >= std::numeric_limits<_Td>::min() / std::numeric_limits<_Td>::epsilon()) {
+		return std::sqrt(sum);
+	}
+	// out of range: norms of the rows, which scale themselves, then the norm of those
+	std::vector<_Td> rows(X.RowSize());
+	for (size_t i = 0; i < rows.size(); ++i) {
+		rows[i] = Kernel::Nrm2(X.ColSize(), X[i]);
+	}
+	return Kernel::Nrm2(rows.size(), rows.data());
+}
+
+}
+#endif
@@ -0,0 +1,345 @@
+#ifndef DIAMOND_MATRIX_EXPR_HPP
+#define DIAMOND_MATRIX_EXPR_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace Diamond {
+
+/**
+ * Lazy element-wise matrix arithmetic.
+ *
+ * a + b, a - b, -a, a * s, s * a and a / s build small expression nodes instead of matrices.
+ * A whole chain like A + B - C * 2.0 is evaluated in a single pass over the elements
+ * when it is converted or assigned to a Matrix, and assigning to a matrix of the
+ * same shape writes into its buffer without allocating.
+ * The product of two matrices is not element-wise, it is materialized through the GEMM kernel.
+ *
+ * A node refers to the matrices it was built from when they are lvalues and owns
+ * them when they are temporaries, so keep `auto e = a + b;` no longer than a and b.
+ * When a temporary expression owns a matrix, e.g. std::move(a) + b or a * b + c,
+ * the result is evaluated into the buffer of that matrix instead of a new one.
+ * The leaves that read a matrix in place are in matrix-view.hpp. When one of them overlaps
+ * the destination at other positions, e.g. a = Transposed(a) + b, the result goes
+ * through a new buffer.
+ */
+
+/**
+ * The shape of a Matrix is given at run time unless both dimensions are template arguments,
+ * see matrix-fixed.hpp.
+ */
+const size_t MATRIX_DYNAMIC = static_cast<size_t>(-1);
+
+template<typename _Td, size_t _Rows = MATRIX_DYNAMIC, size_t _Cols = MATRIX_DYNAMIC>
+class Matrix;
+template<typename _Td>
+class ConstMatrixView;
+
+struct MatrixExprTag {};
+
+template<typename _Td, typename _Ex>
+class MatrixExpr : public MatrixExprTag {
+public:
+	typedef _Td value_type;
+	const _Ex & derived() const
+	{
+		return static_cast<const _Ex &>(*this);
+	}
+	size_t RowSize() const
+	{
+		return derived().RowSize();
+	}
+	size_t ColSize() const
+	{
+		return derived().ColSize();
+	}
+	decltype(auto) operator()(const size_t &i, const size_t &j) const
+	{
+		return derived()(i, j);
+	}
+	/**
+	 * expr[i][j] reads one element, like it does on a Matrix.
+	 */
+	class ConstRow {
+		const _Ex &expr;
+		size_t row;
+	public:
+		ConstRow(const _Ex &_expr, const size_t &_row) : expr(_expr), row(_row) {}
+		decltype(auto) operator[](const size_t &pos) const
+		{
+			return expr(row, pos);
+		}
+	};
+	ConstRow operator[](const size_t &Kth) const
+	{
+		return ConstRow(derived(), Kth);
+	}
+};
+
+template<typename _Tp>
+struct IsMatrixExpr : std::is_base_of<MatrixExprTag, typename std::decay<_Tp>::type> {};
+
+/**
+ * A matrix owned by an expression whose buffer can take the result, nullptr if there is none.
+ * Every operand of an element-wise node has the shape of the result.
+ */
+template<typename _Td>
+Matrix<_Td> * ExprBuffer(Matrix<_Td> &owned)
+{
+	return &owned;
+}
+
+template<typename _Td, typename _Ex>
+Matrix<_Td> * ExprBuffer(MatrixExpr<_Td, _Ex> &expr)
+{
+	return static_cast<_Ex &>(expr).Buffer();
+}
+
+/**
+ * Whether an expression reads elements of dst at other positions than the one it computes,
+ * so that evaluating it into dst would read elements already overwritten.
+ * A matrix owned by the expression has a buffer of its own.
+ */
+template<typename _Td>
+bool ExprAliases(const Matrix<_Td> &, const ConstMatrixView<_Td> &)
+{
+	return false;
+}
+
+template<typename _Td, typename _Ex>
+bool ExprAliases(const MatrixExpr<_Td, _Ex> &expr, const ConstMatrixView<_Td> &dst)
+{
+	return expr.derived().Aliases(dst);
+}
+
+/**
+ * How a node keeps an operand: lvalue matrices through a view, temporaries, views and nodes by value.
+ */
+template<typename _Tp>
+struct ExprOperand {
+	typedef typename std::decay<_Tp>::type type;
+};
+template<typename _Td>
+struct ExprOperand<Matrix<_Td> &> {
+	typedef ConstMatrixView<_Td> type;
+};
+template<typename _Td>
+struct ExprOperand<const Matrix<_Td> &> {
+	typedef ConstMatrixView<_Td> type;
+};
+
+struct ExprAdd {
+	template<typename _Tp>
+	static _Tp Apply(const _Tp &a, const _Tp &b)
+	{
+		return a + b;
+	}
+};
+struct ExprSub {
+	template<typename _Tp>
+	static _Tp Apply(const _Tp &a, const _Tp &b)
+	{
+		return a - b;
+	}
+};
+struct ExprNeg {
+	template<typename _Tp>
+	static _Tp Apply(const _Tp &a)
+	{
+		return -a;
+	}
+};
+struct ExprMulScalar {
+	template<typename _Tp, typename _Ts>
+	static _Tp Apply(const _Tp &a, const _Ts &s)
+	{
+		return a * s;
+	}
+};
+struct ExprScalarMul {
+	template<typename _Tp, typename _Ts>
+	static _Tp Apply(const _Tp &a, const _Ts &s)
+	{
+		return s * a;
+	}
+};
+struct ExprDivScalar {
+	template<typename _Tp, typename _Ts>
+	static _Tp Apply(const _Tp &a, const _Ts &s)
+	{
+		return a / s;
+	}
+};
+
+template<typename _Td, typename _L, typename _R, typename _Op>
+class BinaryExpr : public MatrixExpr<_Td, BinaryExpr<_Td, _L, _R, _Op>> {
+	_L lhs;
+	_R rhs;
+public:
+	template<typename _A, typename _B>
+	BinaryExpr(_A &&a, _B &&b) : lhs(std::forward<_A>(a)), rhs(std::forward<_B>(b))
+	{
+		if (lhs.RowSize() != rhs.RowSize() || lhs.ColSize() != rhs.ColSize()) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+	}
+	size_t RowSize() const
+	{
+		return lhs.RowSize();
+	}
+	size_t ColSize() const
+	{
+		return lhs.ColSize();
+	}
+	_Td operator()(const size_t &i, const size_t &j) const
+	{
+		return _Op::Apply(static_cast<const _Td &>(lhs(i, j)), static_cast<const _Td &>(rhs(i, j)));
+	}
+	Matrix<_Td> * Buffer()
+	{
+		Matrix<_Td> *owned = ExprBuffer(lhs);
+		return owned ? owned : ExprBuffer(rhs);
+	}
+	bool Aliases(const ConstMatrixView<_Td> &dst) const
+	{
+		return ExprAliases(lhs, dst) || ExprAliases(rhs, dst);
+	}
+	const _L & Lhs() const
+	{
+		return lhs;
+	}
+	const _R & Rhs() const
+	{
+		return rhs;
+	}
+};
+
+template<typename _Td, typename _E, typename _Op>
+class UnaryExpr : public MatrixExpr<_Td, UnaryExpr<_Td, _E, _Op>> {
+	_E arg;
+public:
+	template<typename _A>
+	explicit UnaryExpr(_A &&a) : arg(std::forward<_A>(a)) {}
+	size_t RowSize() const
+	{
+		return arg.RowSize();
+	}
+	size_t ColSize() const
+	{
+		return arg.ColSize();
+	}
+	_Td operator()(const size_t &i, const size_t &j) const
+	{
+		return _Op::Apply(static_cast<const _Td &>(arg(i, j)));
+	}
+	Matrix<_Td> * Buffer()
+	{
+		return ExprBuffer(arg);
+	}
+	bool Aliases(const ConstMatrixView<_Td> &dst) const
+	{
+		return ExprAliases(arg, dst);
+	}
+	const _E & Arg() const
+	{
+		return arg;
+	}
+};
+
+template<typename _Td, typename _E, typename _Ts, typename _Op>
+class ScalarExpr : public MatrixExpr<_Td, ScalarExpr<_Td, _E, _Ts, _Op>> {
+	_E arg;
+	_Ts scalar;
+public:
+	template<typename _A>
+	ScalarExpr(_A &&a, const _Ts &s) : arg(std::forward<_A>(a)), scalar(s) {}
+	size_t RowSize() const
+	{
+		return arg.RowSize();
+	}
+	size_t ColSize() const
+	{
+		return arg.ColSize();
+	}
+	_Td operator()(const size_t &i, const size_t &j) const
+	{
+		return _Op::Apply(static_cast<const _Td &>(arg(i, j)), scalar);
+	}
+	Matrix<_Td> * Buffer()
+	{
+		return ExprBuffer(arg);
+	}
+	bool Aliases(const ConstMatrixView<_Td> &dst) const
+	{
+		return ExprAliases(arg, dst);
+	}
+	const _E & Arg() const
+	{
+		return arg;
+	}
+};
+
+template<typename _Tp>
+using ExprValue = typename std::decay<_Tp>::type::value_type;
+
+template<typename _L, typename _R>
+using EnableIfExprs = typename std::enable_if<IsMatrixExpr<_L>::value && IsMatrixExpr<_R>::value
+	&& std::is_same<ExprValue<_L>, ExprValue<_R>>::value>::type;
+
+template<typename _E>
+using EnableIfExpr = typename std::enable_if<IsMatrixExpr<_E>::value>::type;
+
+/**
+ * Sum of two matrics.
+ */
+template<typename _L, typename _R, typename = EnableIfExprs<_L, _R>>
+BinaryExpr<ExprValue<_L>, typename ExprOperand<_L>::type, typename ExprOperand<_R>::type, ExprAdd>
+operator+(_L &&a, _R &&b)
+{
+	return BinaryExpr<ExprValue<_L>, typename ExprOperand<_L>::type, typename ExprOperand<_R>::type, ExprAdd>(
+		std::forward<_L>(a), std::forward<_R>(b));
+}
+
+template<typename _L, typename _R, typename = EnableIfExprs<_L, _R>>
+BinaryExpr<ExprValue<_L>, typename ExprOperand<_L>::type, typename ExprOperand<_R>::type, ExprSub>
+operator-(_L &&a, _R &&b)
+{
+	return BinaryExpr<ExprValue<_L>, typename ExprOperand<_L>::type, typename ExprOperand<_R>::type, ExprSub>(
+		std::forward<_L>(a), std::forward<_R>(b));
+}
+
+template<typename _E, typename = EnableIfExpr<_E>>
+UnaryExpr<ExprValue<_E>, typename ExprOperand<_E>::type, ExprNeg>
+operator-(_E &&a)
+{
+	return UnaryExpr<ExprValue<_E>, typename ExprOperand<_E>::type, ExprNeg>(std::forward<_E>(a));
+}
+
+/**
+ * Operations between a number and a matrix;
+ */
+template<typename _E, typename = EnableIfExpr<_E>>
+ScalarExpr<ExprValue<_E>, typename ExprOperand<_E>::type, ExprValue<_E>, ExprMulScalar>
+operator*(_E &&a, const ExprValue<_E> &b)
+{
+	return ScalarExpr<ExprValue<_E>, typename ExprOperand<_E>::type, ExprValue<_E>, ExprMulScalar>(std::forward<_E>(a), b);
+}
+
+template<typename _E, typename = EnableIfExpr<_E>>
+ScalarExpr<ExprValue<_E>, typename ExprOperand<_E>::type, ExprValue<_E>, ExprScalarMul>
+operator*(const ExprValue<_E> &b, _E &&a)
+{
+	return ScalarExpr<ExprValue<_E>, typename ExprOperand<_E>::type, ExprValue<_E>, ExprScalarMul>(std::forward<_E>(a), b);
+}
+
+template<typename _E, typename = EnableIfExpr<_E>>
+ScalarExpr<ExprValue<_E>, typename ExprOperand<_E>::type, double, ExprDivScalar>
+operator/(_E &&a, const double &b)
+{
+	return ScalarExpr<ExprValue<_E>, typename ExprOperand<_E>::type, double, ExprDivScalar>(std::forward<_E>(a), b);
+}
+
+}
+#endif
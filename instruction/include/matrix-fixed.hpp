@@ -0,0 +1,323 @@
+#ifndef DIAMOND_MATRIX_FIXED_HPP
+#define DIAMOND_MATRIX_FIXED_HPP
+
+#include <iostream>
+#include <iomanip>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include "matrix-thread.hpp"
+#include "matrix-expr.hpp"
+
+namespace Diamond {
+
+/**
+ * Matrix<_Td, R, C>: a matrix whose shape is part of its type.
+ *
+ * The R x C elements are kept row-major inside the object, no allocation is made,
+ * and every operation is constexpr. Mixing shapes that do not match is a compile
+ * error instead of std::invalid_argument. The loops have bounds known at compile
+ * time, so the compiler unrolls them and keeps small matrices in registers.
+ *
+ * Fixed matrices are not expressions: a + b and a * b are computed right away,
+ * which is cheaper than building a node for a few elements.
+ * They convert explicitly to and from Matrix<_Td>, the shape of which is given at run time.
+ */
+template<size_t _Rows, size_t _Cols>
+using EnableIfFixed = typename std::enable_if<_Rows != MATRIX_DYNAMIC && _Cols != MATRIX_DYNAMIC>::type;
+
+template<typename _Td, size_t _Rows, size_t _Cols>
+class Matrix {
+	static_assert(_Rows != MATRIX_DYNAMIC && _Cols != MATRIX_DYNAMIC, "both dimensions of a fixed matrix must be given");
+
+	std::array<_Td, _Rows * _Cols> elems;
+public:
+	typedef _Td value_type;
+
+	/**
+	 * Value-initialized elements, zeros for numbers.
+	 */
+	constexpr Matrix() : elems{} {}
+	constexpr explicit Matrix(const _Td &fillValue) : elems{}
+	{
+		for (size_t i = 0; i < _Rows * _Cols; ++i) {
+			elems[i] = fillValue;
+		}
+	}
+	/**
+	 * All R * C elements, row after row: Matrix<double, 2, 2> m(1, 2, 3, 4).
+	 */
+	template<typename... _Args, typename = typename std::enable_if<(sizeof...(_Args) == _Rows * _Cols && sizeof...(_Args) > 1)>::type>
+	constexpr Matrix(const _Args &...args) : elems{{static_cast<_Td>(args)...}} {}
+	constexpr explicit Matrix(const std::array<_Td, _Rows * _Cols> &values) : elems(values) {}
+	explicit Matrix(const Matrix<_Td> &mat) : elems{}
+	{
+		if (mat.RowSize() != _Rows || mat.ColSize() != _Cols) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+		for (size_t i = 0; i < _Rows; ++i) {
+			for (size_t j = 0; j < _Cols; ++j) {
+				elems[i * _Cols + j] = mat(i, j);
+			}
+		}
+	}
+	explicit operator Matrix<_Td>() const
+	{
+		Matrix<_Td> res(_Rows, _Cols);
+		for (size_t i = 0; i < _Rows; ++i) {
+			for (size_t j = 0; j < _Cols; ++j) {
+				res(i, j) = elems[i * _Cols + j];
+			}
+		}
+		return res;
+	}
+
+	constexpr Matrix & operator+=(const Matrix &b)
+	{
+		for (size_t i = 0; i < _Rows * _Cols; ++i) {
+			elems[i] = elems[i] + b.elems[i];
+		}
+		return *this;
+	}
+	constexpr Matrix & operator-=(const Matrix &b)
+	{
+		for (size_t i = 0; i < _Rows * _Cols; ++i) {
+			elems[i] = elems[i] - b.elems[i];
+		}
+		return *this;
+	}
+	/**
+	 * Only square matrices keep their shape when multiplied in place.
+	 */
+	constexpr Matrix & operator*=(const Matrix &b)
+	{
+		static_assert(_Rows == _Cols, "different matrics\'s sizes");
+		return *this = *this * b;
+	}
+	constexpr Matrix & operator*=(const _Td &b)
+	{
+		for (size_t i = 0; i < _Rows * _Cols; ++i) {
+			elems[i] = elems[i] * b;
+		}
+		return *this;
+	}
+	constexpr Matrix & operator/=(const double &b)
+	{
+		for (size_t i = 0; i < _Rows * _Cols; ++i) {
+			elems[i] = elems[i] / b;
+		}
+		return *this;
+	}
+
+	static constexpr size_t RowSize()
+	{
+		return _Rows;
+	}
+	static constexpr size_t ColSize()
+	{
+		return _Cols;
+	}
+	static constexpr size_t stride()
+	{
+		return _Cols;
+	}
+	constexpr _Td * data()
+	{
+		return elems.data();
+	}
+	constexpr const _Td * data() const
+	{
+		return elems.data();
+	}
+	constexpr _Td * operator[](const size_t &Kth)
+	{
+		return elems.data() + Kth * _Cols;
+	}
+	constexpr const _Td * operator[](const size_t &Kth) const
+	{
+		return elems.data() + Kth * _Cols;
+	}
+	constexpr _Td & operator()(const size_t &i, const size_t &j)
+	{
+		return elems[i * _Cols + j];
+	}
+	constexpr const _Td & operator()(const size_t &i, const size_t &j) const
+	{
+		return elems[i * _Cols + j];
+	}
+};
+
+template<typename _Td, size_t _R, size_t _C, typename = EnableIfFixed<_R, _C>>
+constexpr bool operator==(const Matrix<_Td, _R, _C> &a, const Matrix<_Td, _R, _C> &b)
+{
+	for (size_t i = 0; i < _R * _C; ++i) {
+		if (!(a.data()[i] == b.data()[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename _Td, size_t _R, size_t _C, typename = EnableIfFixed<_R, _C>>
+constexpr bool operator!=(const Matrix<_Td, _R, _C> &a, const Matrix<_Td, _R, _C> &b)
+{
+	return !(a == b);
+}
+
+template<typename _Td, size_t _R, size_t _C, typename = EnableIfFixed<_R, _C>>
+constexpr Matrix<_Td, _R, _C> operator+(Matrix<_Td, _R, _C> a, const Matrix<_Td, _R, _C> &b)
+{
+	return a += b;
+}
+
+template<typename _Td, size_t _R, size_t _C, typename = EnableIfFixed<_R, _C>>
+constexpr Matrix<_Td, _R, _C> operator-(Matrix<_Td, _R, _C> a, const Matrix<_Td, _R, _C> &b)
+{
+	return a -= b;
+}
+
+template<typename _Td, size_t _R, size_t _C, typename = EnableIfFixed<_R, _C>>
+constexpr Matrix<_Td, _R, _C> operator-(const Matrix<_Td, _R, _C> &a)
+{
+	Matrix<_Td, _R, _C> res;
+	for (size_t i = 0; i < _R * _C; ++i) {
+		res.data()[i] = -a.data()[i];
+	}
+	return res;
+}
+
+template<typename _Td, size_t _R, size_t _C, typename = EnableIfFixed<_R, _C>>
+constexpr Matrix<_Td, _R, _C> operator*(Matrix<_Td, _R, _C> a, const typename Matrix<_Td, _R, _C>::value_type &b)
+{
+	return a *= b;
+}
+
+template<typename _Td, size_t _R, size_t _C, typename = EnableIfFixed<_R, _C>>
+constexpr Matrix<_Td, _R, _C> operator*(const typename Matrix<_Td, _R, _C>::value_type &b, const Matrix<_Td, _R, _C> &a)
+{
+	Matrix<_Td, _R, _C> res;
+	for (size_t i = 0; i < _R * _C; ++i) {
+		res.data()[i] = b * a.data()[i];
+	}
+	return res;
+}
+
+template<typename _Td, size_t _R, size_t _C, typename = EnableIfFixed<_R, _C>>
+constexpr Matrix<_Td, _R, _C> operator/(Matrix<_Td, _R, _C> a, const double &b)
+{
+	return a /= b;
+}
+
+/**
+ * Product of two fixed matrices, the inner sizes must match.
+ * Row i of the result is accumulated as a(i, k) times row k of b, so the innermost
+ * loop runs along contiguous rows and vectorizes once the loops are unrolled.
+ */
+template<typename _Td, size_t _R, size_t _K, size_t _K2, size_t _C,
+	typename = EnableIfFixed<_R, _K>, typename = EnableIfFixed<_K2, _C>>
+constexpr Matrix<_Td, _R, _C> operator*(const Matrix<_Td, _R, _K> &a, const Matrix<_Td, _K2, _C> &b)
+{
+	static_assert(_K == _K2, "different matrics\'s sizes");
+	Matrix<_Td, _R, _C> res;
+#pragma GCC unroll 16
+	for (size_t i = 0; i < _R; ++i) {
+#pragma GCC unroll 16
+		for (size_t k = 0; k < _K; ++k) {
+			const _Td aik = a(i, k);
+#pragma GCC unroll 16
+			for (size_t j = 0; j < _C; ++j) {
+				res(i, j) = res(i, j) + aik * b(k, j);
+			}
+		}
+	}
+	return res;
+}
+
+template<typename _Td, size_t _R, size_t _C, typename = EnableIfFixed<_R, _C>>
+constexpr Matrix<_Td, _C, _R> Transpose(const Matrix<_Td, _R, _C> &a)
+{
+	Matrix<_Td, _C, _R> res;
+	for (size_t i = 0; i < _R; ++i) {
+		for (size_t j = 0; j < _C; ++j) {
+			res(j, i) = a(i, j);
+		}
+	}
+	return res;
+}
+
+template<typename _Td, size_t _N>
+constexpr Matrix<_Td, _N, _N> I()
+{
+	Matrix<_Td, _N, _N> res;
+	for (size_t i = 0; i < _N; ++i) {
+		res(i, i) = static_cast<_Td>(1);
+	}
+	return res;
+}
+
+/**
+ * out[v] = m * in[v] for count vectors of C elements stored one after the other in in,
+ * the R elements of each result one after the other in out. in and out must not overlap.
+ * Each result is built as a sum of the columns of m scaled by the elements of the vector,
+ * which maps to a few vector multiply-adds for 3- and 4-element vectors.
+ * Long batches are split between the threads of Kernel::Pool().
+ */
+template<typename _Td, size_t _R, size_t _C, typename = EnableIfFixed<_R, _C>>
+void Transform(const Matrix<_Td, _R, _C> &m, const _Td *in, _Td *out, const size_t &count)
+{
+	const Matrix<_Td, _C, _R> cols = Transpose(m);
+	Kernel::ParallelRows(count, _R * _C, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; ++v) {
+			const _Td *x = in + v * _C;
+			std::array<_Td, _R> y{};
+#pragma GCC unroll 16
+			for (size_t c = 0; c < _C; ++c) {
+				const _Td xc = x[c];
+#pragma GCC unroll 16
+				for (size_t r = 0; r < _R; ++r) {
+					y[r] = y[r] + cols(c, r) * xc;
+				}
+			}
+			_Td *z = out + v * _R;
+			for (size_t r = 0; r < _R; ++r) {
+				z[r] = y[r];
+			}
+		}
+	});
+}
+
+/**
+ * out[v] = m * in[v] for count column vectors.
+ */
+template<typename _Td, size_t _R, size_t _C, typename = EnableIfFixed<_R, _C>>
+void Transform(const Matrix<_Td, _R, _C> &m, const Matrix<_Td, _C, 1> *in, Matrix<_Td, _R, 1> *out, const size_t &count)
+{
+	Kernel::ParallelRows(count, _R * _C, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; ++v) {
+			out[v] = m * in[v];
+		}
+	});
+}
+
+template<typename _Td, size_t _R, size_t _C, typename = EnableIfFixed<_R, _C>>
+std::ostream & operator<<(std::ostream &stream, const Matrix<_Td, _R, _C> &mat)
+{
+	std::ostream::fmtflags oldFlags = stream.flags();
+	stream.precision(8);
+	stream.setf(std::ios::fixed | std::ios::right);
+
+	stream << '\n';
+	for (size_t i = 0; i < _R; ++i) {
+		for (size_t j = 0; j < _C; ++j) {
+			stream << std::setw(15) << mat(i, j);
+		}
+		stream << '\n';
+	}
+
+	stream.flags(oldFlags);
+	return stream;
+}
+
+}
+#endif
@@ -0,0 +1,412 @@
+#ifndef DIAMOND_MATRIX_GEMM_HPP
+#define DIAMOND_MATRIX_GEMM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <new>
+#include <type_traits>
+#include "matrix-thread.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define DIAMOND_GEMM_X86 1
+#endif
+
+namespace Diamond {
+
+/**
+ * Packed, cache-blocked matrix multiplication for arithmetic element types.
+ *
+ * C (M x N) = alpha * A (M x K) * B (K x N) + beta * C
+ *
+ * A and B are read through a row stride and a column stride, so a transposed
+ * operand is just a swap of the two strides. C is row-major with leading dimension ldc.
+ * Blocks of B (KC x NC) and A (MC x KC) are copied into aligned panels that a
+ * micro-kernel streams through while it keeps an MR x NR tile of C in registers.
+ * The micro-kernel is picked at runtime among AVX-512, AVX2 and portable C++.
+ * With more than one thread (see SetThreadCount) C is cut into a grid of tiles,
+ * one per thread, each multiplied with its own packing buffers.
+ */
+namespace Kernel {
+
+/**
+ * Products with fewer multiply-adds than this stay on the calling thread.
+ */
+const size_t GEMM_PARALLEL_MIN_MNK = 1 << 18;
+
+enum class GemmIsa { Scalar, Avx2, Avx512 };
+
+inline GemmIsa DetectGemmIsa()
+{
+#ifdef DIAMOND_GEMM_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+		return GemmIsa::Avx512;
+	}
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		return GemmIsa::Avx2;
+	}
+#endif
+	return GemmIsa::Scalar;
+}
+
+/**
+ * The instruction set used by Gemm, detected once.
+ * It may be lowered, e.g. to compare the kernels, but not raised above what the CPU has.
+ */
+inline GemmIsa & ActiveGemmIsa()
+{
+	static GemmIsa isa = DetectGemmIsa();
+	return isa;
+}
+
+/**
+ * Element types taking the packed path: every arithmetic type but bool.
+ * The SIMD kernels cover the 4 and 8 byte ones (float, double, 32/64-bit integers).
+ */
+template<typename _Td>
+struct GemmSupported
+	: std::integral_constant<bool, std::is_arithmetic<_Td>::value && !std::is_same<_Td, bool>::value> {};
+
+template<typename _Td>
+struct GemmVectorizable
+	: std::integral_constant<bool, GemmSupported<_Td>::value && (sizeof(_Td) == 4 || sizeof(_Td) == 8)> {};
+
+template<typename _Td>
+class AlignedBuffer {
+	_Td *ptr = nullptr;
+	size_t cap = 0;
+public:
+	AlignedBuffer() {}
+	explicit AlignedBuffer(const size_t &len)
+	{
+		Reserve(len);
+	}
+	/**
+	 * Room for at least len elements, the old content is not kept.
+	 */
+	void Reserve(const size_t &len)
+	{
+		if (len <= cap) {
+			return;
+		}
+		_Td *fresh = static_cast<_Td *>(::operator new(len * sizeof(_Td), std::align_val_t(64)));
+		if (ptr) {
+			::operator delete(ptr, std::align_val_t(64));
+		}
+		ptr = fresh;
+		cap = len;
+	}
+	AlignedBuffer(const AlignedBuffer &) = delete;
+	AlignedBuffer & operator=(const AlignedBuffer &) = delete;
+	_Td * get() const
+	{
+		return ptr;
+	}
+	~AlignedBuffer()
+	{
+		if (ptr) {
+			::operator delete(ptr, std::align_val_t(64));
+		}
+	}
+};
+
+/**
+ * C[0..mr)[0..nr) += a * b, where a is an MR-row panel and b an NR-column panel of depth kc.
+ * The full tile is accumulated in MR * NR / W vector registers.
+ */
+#ifdef DIAMOND_GEMM_X86
+template<typename _Td, size_t MR, size_t NR, size_t VB>
+__attribute__((always_inline)) inline void _MicroKernelVec(const size_t &kc, const _Td *a, const _Td *b, _Td *c, const size_t &ldc, const size_t &mr, const size_t &nr)
+{
+	typedef _Td vec __attribute__((vector_size(VB)));
+	typedef _Td uvec __attribute__((vector_size(VB), aligned(sizeof(_Td))));
+	const size_t W = VB / sizeof(_Td);
+	const size_t NV = NR / W;
+	vec acc[MR][NV];
+#pragma GCC unroll 32
+	for (size_t i = 0; i < MR; ++i) {
+#pragma GCC unroll 4
+		for (size_t v = 0; v < NV; ++v) {
+			acc[i][v] = vec{};
+		}
+	}
+	for (size_t p = 0; p < kc; ++p) {
+		vec bv[NV];
+#pragma GCC unroll 4
+		for (size_t v = 0; v < NV; ++v) {
+			bv[v] = reinterpret_cast<const vec *>(b)[v];
+		}
+#pragma GCC unroll 32
+		for (size_t i = 0; i < MR; ++i) {
+			const vec av = a[i] - vec{};
+#pragma GCC unroll 4
+			for (size_t v = 0; v < NV; ++v) {
+				acc[i][v] += av * bv[v];
+			}
+		}
+		a += MR;
+		b += NR;
+	}
+	if (mr == MR && nr == NR) {
+#pragma GCC unroll 32
+		for (size_t i = 0; i < MR; ++i) {
+#pragma GCC unroll 4
+			for (size_t v = 0; v < NV; ++v) {
+				*reinterpret_cast<uvec *>(c + i * ldc + v * W) += acc[i][v];
+			}
+		}
+	}
+	else {
+		alignas(64) _Td tmp[MR][NR];
+		for (size_t i = 0; i < MR; ++i) {
+			for (size_t v = 0; v < NV; ++v) {
+				*reinterpret_cast<vec *>(tmp[i] + v * W) = acc[i][v];
+			}
+		}
+		for (size_t i = 0; i < mr; ++i) {
+			for (size_t j = 0; j < nr; ++j) {
+				c[i * ldc + j] += tmp[i][j];
+			}
+		}
+	}
+}
+#endif
+
+template<typename _Td>
+struct ScalarKernel {
+	static constexpr size_t MR = 4, NR = 4, MC = 64, KC = 256, NC = 1024;
+	static void Run(const size_t &kc, const _Td *a, const _Td *b, _Td *c, const size_t &ldc, const size_t &mr, const size_t &nr)
+	{
+		_Td acc[MR][NR] = {};
+		for (size_t p = 0; p < kc; ++p) {
+			for (size_t i = 0; i < MR; ++i) {
+				for (size_t j = 0; j < NR; ++j) {
+					acc[i][j] += a[i] * b[j];
+				}
+			}
+			a += MR;
+			b += NR;
+		}
+		for (size_t i = 0; i < mr; ++i) {
+			for (size_t j = 0; j < nr; ++j) {
+				c[i * ldc + j] += acc[i][j];
+			}
+		}
+	}
+};
+
+#ifdef DIAMOND_GEMM_X86
+/**
+ * 6 x 2 ymm accumulators: 6 x 8 doubles, 6 x 16 floats.
+ */
+template<typename _Td>
+struct Avx2Kernel {
+	static constexpr size_t MR = 6, NR = 64 / sizeof(_Td), MC = 72, KC = 256, NC = 4096;
+	__attribute__((target("avx2,fma"))) __attribute__((noinline))
+	static void Run(const size_t &kc, const _Td *a, const _Td *b, _Td *c, const size_t &ldc, const size_t &mr, const size_t &nr)
+	{
+		_MicroKernelVec<_Td, MR, NR, 32>(kc, a, b, c, ldc, mr, nr);
+	}
+};
+
+/**
+ * 12 x 2 zmm accumulators: 12 x 16 doubles, 12 x 32 floats.
+ */
+template<typename _Td>
+struct Avx512Kernel {
+	static constexpr size_t MR = 12, NR = 128 / sizeof(_Td), MC = 96, KC = 384, NC = 4096;
+	__attribute__((target("avx512f,avx512dq,avx512vl,avx2,fma"))) __attribute__((noinline))
+	static void Run(const size_t &kc, const _Td *a, const _Td *b, _Td *c, const size_t &ldc, const size_t &mr, const size_t &nr)
+	{
+		_MicroKernelVec<_Td, MR, NR, 64>(kc, a, b, c, ldc, mr, nr);
+	}
+};
+#endif
+
+/**
+ * Copy alpha * A[0..mc)[0..kc) into panels of MR rows, each stored k-major, zero padded.
+ */
+template<typename _Td, size_t MR>
+void _PackA(const size_t &mc, const size_t &kc, const _Td &alpha, const _Td *A, const std::ptrdiff_t &rsa, const std::ptrdiff_t &csa, _Td *pack)
+{
+	for (size_t ir = 0; ir < mc; ir += MR) {
+		const size_t mr = std::min(MR, mc - ir);
+		for (size_t p = 0; p < kc; ++p) {
+			const _Td *src = A + static_cast<std::ptrdiff_t>(ir) * rsa + static_cast<std::ptrdiff_t>(p) * csa;
+			for (size_t i = 0; i < mr; ++i) {
+				pack[i] = alpha * src[static_cast<std::ptrdiff_t>(i) * rsa];
+			}
+			for (size_t i = mr; i < MR; ++i) {
+				pack[i] = _Td(0);
+			}
+			pack += MR;
+		}
+	}
+}
+
+/**
+ * Copy B[0..kc)[0..nc) into panels of NR columns, each stored k-major, zero padded.
+ */
+template<typename _Td, size_t NR>
+void _PackB(const size_t &kc, const size_t &nc, const _Td *B, const std::ptrdiff_t &rsb, const std::ptrdiff_t &csb, _Td *pack)
+{
+	for (size_t jr = 0; jr < nc; jr += NR) {
+		const size_t nr = std::min(NR, nc - jr);
+		for (size_t p = 0; p < kc; ++p) {
+			const _Td *src = B + static_cast<std::ptrdiff_t>(p) * rsb + static_cast<std::ptrdiff_t>(jr) * csb;
+			if (csb == 1) {
+				std::copy(src, src + nr, pack);
+			}
+			else {
+				for (size_t j = 0; j < nr; ++j) {
+					pack[j] = src[static_cast<std::ptrdiff_t>(j) * csb];
+				}
+			}
+			std::fill(pack + nr, pack + NR, _Td(0));
+			pack += NR;
+		}
+	}
+}
+
+template<typename _Td>
+void _ScaleC(const size_t &M, const size_t &N, const _Td &beta, _Td *C, const size_t &ldc)
+{
+	if (beta == _Td(1)) {
+		return;
+	}
+	for (size_t i = 0; i < M; ++i) {
+		_Td *pc = C + i * ldc;
+		if (beta == _Td(0)) {
+			std::fill(pc, pc + N, _Td(0));
+		}
+		else {
+			for (size_t j = 0; j < N; ++j) {
+				pc[j] *= beta;
+			}
+		}
+	}
+}
+
+template<typename _Td, typename _Kernel>
+void _GemmBlocked(const size_t &M, const size_t &N, const size_t &K, const _Td &alpha,
+	const _Td *A, const std::ptrdiff_t &rsa, const std::ptrdiff_t &csa,
+	const _Td *B, const std::ptrdiff_t &rsb, const std::ptrdiff_t &csb,
+	_Td *C, const size_t &ldc)
+{
+	const size_t MR = _Kernel::MR, NR = _Kernel::NR;
+	const size_t mcMax = (std::min(M, _Kernel::MC) + MR - 1) / MR * MR;
+	const size_t ncMax = (std::min(N, _Kernel::NC) + NR - 1) / NR * NR;
+	const size_t kcMax = std::min(K, _Kernel::KC);
+	// every thread keeps its packing buffers, so repeated products do not allocate
+	static thread_local AlignedBuffer<_Td> packA, packB;
+	packA.Reserve(mcMax * kcMax);
+	packB.Reserve(kcMax * ncMax);
+	for (size_t jc = 0; jc < N; jc += _Kernel::NC) {
+		const size_t nc = std::min(_Kernel::NC, N - jc);
+		for (size_t pc = 0; pc < K; pc += _Kernel::KC) {
+			const size_t kc = std::min(_Kernel::KC, K - pc);
+			_PackB<_Td, NR>(kc, nc, B + static_cast<std::ptrdiff_t>(pc) * rsb + static_cast<std::ptrdiff_t>(jc) * csb, rsb, csb, packB.get());
+			for (size_t ic = 0; ic < M; ic += _Kernel::MC) {
+				const size_t mc = std::min(_Kernel::MC, M - ic);
+				_PackA<_Td, MR>(mc, kc, alpha, A + static_cast<std::ptrdiff_t>(ic) * rsa + static_cast<std::ptrdiff_t>(pc) * csa, rsa, csa, packA.get());
+				for (size_t jr = 0; jr < nc; jr += NR) {
+					for (size_t ir = 0; ir < mc; ir += MR) {
+						_Kernel::Run(kc, packA.get() + ir * kc, packB.get() + jr * kc,
+							C + (ic + ir) * ldc + jc + jr, ldc, std::min(MR, mc - ir), std::min(NR, nc - jr));
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Start of part i of p when total is cut at multiples of unit.
+ */
+inline size_t _SplitPoint(const size_t &total, const size_t &unit, const size_t &i, const size_t &p)
+{
+	const size_t units = (total + unit - 1) / unit;
+	return std::min(total, units * i / p * unit);
+}
+
+template<typename _Td, typename _Kernel>
+void _GemmTiled(const size_t &M, const size_t &N, const size_t &K, const _Td &alpha,
+	const _Td *A, const std::ptrdiff_t &rsa, const std::ptrdiff_t &csa,
+	const _Td *B, const std::ptrdiff_t &rsb, const std::ptrdiff_t &csb,
+	const _Td &beta, _Td *C, const size_t &ldc)
+{
+	const size_t threads = Pool().Size();
+	if (threads == 1 || M * N * K < GEMM_PARALLEL_MIN_MNK) {
+		_ScaleC(M, N, beta, C, ldc);
+		_GemmBlocked<_Td, _Kernel>(M, N, K, alpha, A, rsa, csa, B, rsb, csb, C, ldc);
+		return;
+	}
+	// pr x pc tiles, the factorization of threads giving the squarest tiles
+	size_t pr = 1;
+	double best = -1;
+	for (size_t d = 1; d <= threads; ++d) {
+		if (threads % d) {
+			continue;
+		}
+		const double h = double(M) / d, w = double(N) / (threads / d);
+		const double score = std::min(h, w) / std::max(h, w);
+		if (score > best) {
+			best = score;
+			pr = d;
+		}
+	}
+	const size_t pc = threads / pr;
+	Pool().Run(pr * pc, [&](size_t t) {
+		const size_t r0 = _SplitPoint(M, _Kernel::MR, t / pc, pr), r1 = _SplitPoint(M, _Kernel::MR, t / pc + 1, pr);
+		const size_t c0 = _SplitPoint(N, _Kernel::NR, t % pc, pc), c1 = _SplitPoint(N, _Kernel::NR, t % pc + 1, pc);
+		if (r0 == r1 || c0 == c1) {
+			return;
+		}
+		_Td *tile = C + r0 * ldc + c0;
+		_ScaleC(r1 - r0, c1 - c0, beta, tile, ldc);
+		_GemmBlocked<_Td, _Kernel>(r1 - r0, c1 - c0, K, alpha,
+			A + static_cast<std::ptrdiff_t>(r0) * rsa, rsa, csa,
+			B + static_cast<std::ptrdiff_t>(c0) * csb, rsb, csb, tile, ldc);
+	});
+}
+
+/**
+ * C = alpha * A * B + beta * C, see the top of this namespace for the operand layout.
+ * When beta is 0, C is overwritten without being read.
+ */
+template<typename _Td>
+void Gemm(const size_t &M, const size_t &N, const size_t &K, const _Td &alpha,
+	const _Td *A, const std::ptrdiff_t &rsa, const std::ptrdiff_t &csa,
+	const _Td *B, const std::ptrdiff_t &rsb, const std::ptrdiff_t &csb,
+	const _Td &beta, _Td *C, const size_t &ldc)
+{
+	static_assert(GemmSupported<_Td>::value, "Gemm needs an arithmetic element type");
+	if (K == 0 || alpha == _Td(0)) {
+		_ScaleC(M, N, beta, C, ldc);
+		return;
+	}
+	if (M == 0 || N == 0) {
+		return;
+	}
+#ifdef DIAMOND_GEMM_X86
+	if constexpr (GemmVectorizable<_Td>::value) {
+		switch (ActiveGemmIsa()) {
+		case GemmIsa::Avx512:
+			_GemmTiled<_Td, Avx512Kernel<_Td>>(M, N, K, alpha, A, rsa, csa, B, rsb, csb, beta, C, ldc);
+			return;
+		case GemmIsa::Avx2:
+			_GemmTiled<_Td, Avx2Kernel<_Td>>(M, N, K, alpha, A, rsa, csa, B, rsb, csb, beta, C, ldc);
+			return;
+		default:
+			break;
+		}
+	}
+#endif
+	_GemmTiled<_Td, ScalarKernel<_Td>>(M, N, K, alpha, A, rsa, csa, B, rsb, csb, beta, C, ldc);
+}
+
+}
+
+}
+#endif
@@ -0,0 +1,354 @@
+#ifndef DIAMOND_MATRIX_IO_HPP
+#define DIAMOND_MATRIX_IO_HPP
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <charconv>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "matrix-expr.hpp"
+#include "matrix-view.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DIAMOND_MATRIX_MMAP 1
+#endif
+
+namespace Diamond {
+
+/**
+ * Reading and writing matrices of arithmetic types.
+ *
+ * Binary: a 32-byte MatrixFileHeader, then the rows, stride elements apart, in the byte
+ * order of the machine. The writers put the rows back to back (stride == cols).
+ * MappedMatrix maps a file and reads it in place, LoadBinary copies it into a Matrix.
+ *
+ * Text: one row per line, the elements separated by a single character, written by
+ * std::to_chars in the shortest form that reads back to the same value and read by
+ * std::from_chars, without going through the locale or the stream formatting.
+ */
+struct MatrixFileHeader {
+	char magic[4];
+	uint8_t version;
+	/**
+	 * 0x20 for floating point, 0x10 for signed integers, plus the size of an element in bytes.
+	 */
+	uint8_t dtype;
+	uint8_t little;
+	uint8_t reserved;
+	uint64_t rows, cols, stride;
+};
+
+static_assert(sizeof(MatrixFileHeader) == 32, "the header is 32 bytes");
+
+/**
+ * Elements are converted by blocks of this many bytes of text.
+ */
+const size_t MATRIX_TEXT_BUFFER = 1 << 16;
+
+template<typename _Td>
+constexpr uint8_t MatrixDtype()
+{
+	static_assert(std::is_arithmetic<_Td>::value, "only matrices of numbers have a file format");
+	return static_cast<uint8_t>((std::is_floating_point<_Td>::value ? 0x20 : std::is_signed<_Td>::value ? 0x10 : 0) | sizeof(_Td));
+}
+
+inline bool _LittleEndian()
+{
+	const uint16_t one = 1;
+	uint8_t first;
+	std::memcpy(&first, &one, 1);
+	return first == 1;
+}
+
+template<typename _Td>
+MatrixFileHeader _MakeHeader(const size_t &rows, const size_t &cols)
+{
+	MatrixFileHeader header = {{'D', 'M', 'A', 'T'}, 1, MatrixDtype<_Td>(), _LittleEndian(), 0, rows, cols, cols};
+	return header;
+}
+
+/**
+ * Throws std::runtime_error unless the header is one for _Td written on a machine of the same byte order.
+ */
+template<typename _Td>
+void _CheckHeader(const MatrixFileHeader &header)
+{
+	if (std::memcmp(header.magic, "DMAT", 4) != 0 || header.version != 1) {
+		throw std::runtime_error("not a matrix file");
+	}
+	if (header.dtype != MatrixDtype<_Td>()) {
+		throw std::runtime_error("the file holds another element type");
+	}
+	if (static_cast<bool>(header.little) != _LittleEndian()) {
+		throw std::runtime_error("the file was written in the other byte order");
+	}
+	if (header.stride < header.cols || (header.rows && header.stride > SIZE_MAX / sizeof(_Td) / header.rows)) {
+		throw std::runtime_error("the shape in the file is not valid");
+	}
+}
+
+/**
+ * The header, then the elements row by row. Matrices and views are written from their
+ * buffer, a row per call or all at once when the rows are back to back.
+ */
+template<typename _Td, typename _Ex>
+void WriteBinary(std::ostream &stream, const MatrixExpr<_Td, _Ex> &expr)
+{
+	const _Ex &mat = expr.derived();
+	const size_t rows = mat.RowSize(), cols = mat.ColSize();
+	const MatrixFileHeader header = _MakeHeader<_Td>(rows, cols);
+	stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	const std::streamsize bytes = static_cast<std::streamsize>(cols * sizeof(_Td));
+	if constexpr (std::is_convertible<const _Ex &, ConstMatrixView<_Td>>::value) {
+		const ConstMatrixView<_Td> view = mat;
+		if (view.stride() == cols) {
+			stream.write(reinterpret_cast<const char *>(view.data()), bytes * static_cast<std::streamsize>(rows));
+		}
+		else {
+			for (size_t i = 0; i < rows; ++i) {
+				stream.write(reinterpret_cast<const char *>(view[i]), bytes);
+			}
+		}
+	}
+	else {
+		std::vector<_Td> line(cols);
+		for (size_t i = 0; i < rows; ++i) {
+			for (size_t j = 0; j < cols; ++j) {
+				line[j] = mat(i, j);
+			}
+			stream.write(reinterpret_cast<const char *>(line.data()), bytes);
+		}
+	}
+	if (!stream) {
+		throw std::runtime_error("writing the matrix failed");
+	}
+}
+
+/**
+ * Reads what WriteBinary wrote, straight into the rows of the result.
+ */
+template<typename _Td>
+Matrix<_Td> ReadBinary(std::istream &stream)
+{
+	MatrixFileHeader header;
+	if (!stream.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+		throw std::runtime_error("not a matrix file");
+	}
+	_CheckHeader<_Td>(header);
+	Matrix<_Td> res(header.rows, header.cols);
+	const size_t gap = (header.stride - header.cols) * sizeof(_Td);
+	for (size_t i = 0; i < header.rows; ++i) {
+		stream.read(reinterpret_cast<char *>(res[i]), static_cast<std::streamsize>(header.cols * sizeof(_Td)));
+		if (gap && i + 1 < header.rows) {
+			stream.ignore(static_cast<std::streamsize>(gap));
+		}
+	}
+	if (!stream) {
+		throw std::runtime_error("the matrix file is truncated");
+	}
+	return res;
+}
+
+template<typename _Td, typename _Ex>
+void SaveBinary(const std::string &path, const MatrixExpr<_Td, _Ex> &expr)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		throw std::runtime_error("cannot open " + path);
+	}
+	WriteBinary(file, expr);
+}
+
+/**
+ * A matrix file mapped into memory and read in place: View() is valid as long as the object lives.
+ * Where there is no mmap the file is read into a Matrix instead.
+ */
+template<typename _Td>
+class MappedMatrix {
+	ConstMatrixView<_Td> view;
+#ifdef DIAMOND_MATRIX_MMAP
+	void *base = nullptr;
+	size_t length = 0;
+#else
+	Matrix<_Td> copy;
+#endif
+public:
+	explicit MappedMatrix(const std::string &path) : view(nullptr, 0, 0, 0)
+	{
+#ifdef DIAMOND_MATRIX_MMAP
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("cannot open " + path);
+		}
+		struct stat info;
+		if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(MatrixFileHeader)) {
+			::close(fd);
+			throw std::runtime_error("not a matrix file");
+		}
+		length = static_cast<size_t>(info.st_size);
+		base = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (base == MAP_FAILED) {
+			base = nullptr;
+			throw std::runtime_error("cannot map " + path);
+		}
+		MatrixFileHeader header;
+		std::memcpy(&header, base, sizeof(header));
+		try {
+			_CheckHeader<_Td>(header);
+			const size_t payload = header.rows ? ((header.rows - 1) * header.stride + header.cols) * sizeof(_Td) : 0;
+			if (length - sizeof(header) < payload) {
+				throw std::runtime_error("the matrix file is truncated");
+			}
+		}
+		catch (...) {
+			::munmap(base, length);
+			throw;
+		}
+		::madvise(base, length, MADV_SEQUENTIAL);
+		const _Td *elems = reinterpret_cast<const _Td *>(static_cast<const char *>(base) + sizeof(header));
+		view = ConstMatrixView<_Td>(elems, header.rows, header.cols, header.stride);
+#else
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			throw std::runtime_error("cannot open " + path);
+		}
+		copy = ReadBinary<_Td>(file);
+		view = ConstMatrixView<_Td>(copy);
+#endif
+	}
+	MappedMatrix(const MappedMatrix &) = delete;
+	MappedMatrix & operator=(const MappedMatrix &) = delete;
+	~MappedMatrix()
+	{
+#ifdef DIAMOND_MATRIX_MMAP
+		if (base) {
+			::munmap(base, length);
+		}
+#endif
+	}
+	const ConstMatrixView<_Td> & View() const
+	{
+		return view;
+	}
+};
+
+/**
+ * A matrix file copied into a new Matrix through a mapping, the copy is the only pass over the data.
+ */
+template<typename _Td>
+Matrix<_Td> LoadBinary(const std::string &path)
+{
+	MappedMatrix<_Td> mapped(path);
+	return Matrix<_Td>(mapped.View());
+}
+
+/**
+ * One row per line, elements separated by sep.
+ */
+template<typename _Td, typename _Ex>
+void WriteText(std::ostream &stream, const MatrixExpr<_Td, _Ex> &expr, const char &sep = ',')
+{
+	static_assert(std::is_arithmetic<_Td>::value, "WriteText needs a numeric element type");
+	const _Ex &mat = expr.derived();
+	std::vector<char> buffer(MATRIX_TEXT_BUFFER);
+	// the longest element, a long double in scientific form, takes less than 64 characters
+	const size_t room = 64;
+	char *out = buffer.data(), *const limit = buffer.data() + buffer.size() - room;
+	for (size_t i = 0; i < mat.RowSize(); ++i) {
+		for (size_t j = 0; j < mat.ColSize(); ++j) {
+			if (j) {
+				*out++ = sep;
+			}
+			out = std::to_chars(out, out + room - 1, static_cast<_Td>(mat(i, j))).ptr;
+			if (out >= limit) {
+				stream.write(buffer.data(), out - buffer.data());
+				out = buffer.data();
+			}
+		}
+		*out++ = '\n';
+		if (out >= limit) {
+			stream.write(buffer.data(), out - buffer.data());
+			out = buffer.data();
+		}
+	}
+	stream.write(buffer.data(), out - buffer.data());
+	if (!stream) {
+		throw std::runtime_error("writing the matrix failed");
+	}
+}
+
+/**
+ * Reads what WriteText wrote. Spaces around the elements, '\r' line ends and empty
+ * lines are skipped; every row must have the same number of elements.
+ * A file with no elements at all is read as one row of no columns per line, so that
+ * matrices without columns keep their shape.
+ */
+template<typename _Td>
+Matrix<_Td> ReadText(std::istream &stream, const char &sep = ',')
+{
+	static_assert(std::is_arithmetic<_Td>::value, "ReadText needs a numeric element type");
+	std::vector<_Td> values;
+	size_t rows = 0, cols = 0, empty = 0;
+	std::string line;
+	auto blank = [&sep](const char &c) { return c != sep && (c == ' ' || c == '\t' || c == '\r'); };
+	while (std::getline(stream, line)) {
+		const char *p = line.data(), *end = line.data() + line.size();
+		while (p < end && blank(*p)) {
+			++p;
+		}
+		if (p == end) {
+			++empty;
+			continue;
+		}
+		size_t count = 0;
+		for (;;) {
+			while (p < end && blank(*p)) {
+				++p;
+			}
+			_Td value;
+			const std::from_chars_result parsed = std::from_chars(p, end, value);
+			if (parsed.ec != std::errc()) {
+				throw std::runtime_error("bad number in row " + std::to_string(rows + 1));
+			}
+			values.push_back(value);
+			++count;
+			p = parsed.ptr;
+			while (p < end && blank(*p)) {
+				++p;
+			}
+			if (p == end) {
+				break;
+			}
+			if (*p++ != sep) {
+				throw std::runtime_error("bad separator in row " + std::to_string(rows + 1));
+			}
+		}
+		if (rows && count != cols) {
+			throw std::runtime_error("row " + std::to_string(rows + 1) + " has another number of elements");
+		}
+		cols = count;
+		++rows;
+	}
+	if (rows == 0) {
+		rows = empty;
+	}
+	Matrix<_Td> res(rows, cols);
+	for (size_t i = 0; i < rows; ++i) {
+		std::copy(values.begin() + i * cols, values.begin() + (i + 1) * cols, res[i]);
+	}
+	return res;
+}
+
+}
+#endif
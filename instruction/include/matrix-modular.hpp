@@ -0,0 +1,272 @@
+#ifndef DIAMOND_MATRIX_MODULAR_HPP
+#define DIAMOND_MATRIX_MODULAR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include "matrix-thread.hpp"
+
+namespace Diamond {
+
+/**
+ * Matrix products and powers modulo m, for integer matrices whose entries would
+ * overflow, e.g. linear recurrences raised to large exponents.
+ *
+ * Entries are residues in [0, m). Sums of products are reduced lazily: the inner
+ * loop only multiplies and adds, and a row of partial sums is reduced once every
+ * as many terms as fit in the accumulator without overflow, not after every product.
+ *  - m < 2^32: residues are 32-bit and sums of their 64-bit products are reduced by
+ *    Barrett, by a division by a constant when m is a template argument. The inner
+ *    loop is a 32 x 32 -> 64-bit vector multiply-add.
+ *  - odd m < 2^63: residues are kept in Montgomery form, sums of 128-bit products
+ *    are reduced by one Montgomery step after a Barrett step on their high word.
+ *  - other m: sums of 128-bit products are reduced by a 128-bit remainder.
+ */
+namespace Kernel {
+
+typedef unsigned __int128 ModWide;
+
+/**
+ * x mod m for 64-bit x, with floor(2^64 / m) computed once.
+ */
+class ModBarrett {
+	uint64_t mod, ratio;
+public:
+	constexpr explicit ModBarrett(const uint64_t &m) : mod(m), ratio(static_cast<uint64_t>((ModWide(1) << 64) / m)) {}
+	constexpr uint64_t Modulus() const
+	{
+		return mod;
+	}
+	constexpr uint64_t Reduce(const uint64_t &x) const
+	{
+		const uint64_t q = static_cast<uint64_t>((ModWide(x) * ratio) >> 64);
+		const uint64_t r = x - q * mod;
+		return r >= mod ? r - mod : r;
+	}
+};
+
+/**
+ * x mod _Mod, the compiler turns it into a multiplication by a constant.
+ */
+template<uint64_t _Mod>
+class ModConst {
+public:
+	static constexpr uint64_t Modulus()
+	{
+		return _Mod;
+	}
+	static constexpr uint64_t Reduce(const uint64_t &x)
+	{
+		return x % _Mod;
+	}
+};
+
+/**
+ * Montgomery arithmetic for an odd m < 2^63 with R = 2^64: x is kept as x R mod m.
+ */
+class ModMontgomery {
+	uint64_t mod, neg_inv, r2;
+	ModBarrett high;
+
+	static constexpr uint64_t _NegInverse(const uint64_t &m)
+	{
+		// Newton's iteration doubles the correct low bits of m^-1 mod 2^64 each step
+		uint64_t inv = m;
+		for (int i = 0; i < 5; ++i) {
+			inv *= 2 - m * inv;
+		}
+		return ~inv + 1;
+	}
+public:
+	constexpr explicit ModMontgomery(const uint64_t &m)
+		: mod(m), neg_inv(_NegInverse(m)), r2(static_cast<uint64_t>((ModWide(0) - m) % m)), high(m) {}
+	constexpr uint64_t Modulus() const
+	{
+		return mod;
+	}
+	/**
+	 * T R^-1 mod m for T < m 2^64, in [0, 2m).
+	 */
+	constexpr uint64_t Redc(const ModWide &t) const
+	{
+		const uint64_t q = static_cast<uint64_t>(t) * neg_inv;
+		return static_cast<uint64_t>((t + ModWide(q) * mod) >> 64);
+	}
+	/**
+	 * T R^-1 mod m for any T: the high word is reduced first, so that T < m 2^64.
+	 */
+	constexpr uint64_t Reduce(const ModWide &t) const
+	{
+		const uint64_t hi = static_cast<uint64_t>(t >> 64);
+		const uint64_t r = Redc(hi < mod ? t : (ModWide(high.Reduce(hi)) << 64) | static_cast<uint64_t>(t));
+		return r >= mod ? r - mod : r;
+	}
+	constexpr uint64_t To(const uint64_t &x) const
+	{
+		return Reduce(ModWide(x) * r2);
+	}
+	constexpr uint64_t From(const uint64_t &x) const
+	{
+		return Reduce(ModWide(x));
+	}
+	/**
+	 * Sums of up to this many products of residues fit in 128 bits.
+	 */
+	constexpr size_t Lazy() const
+	{
+		const ModWide sq = ModWide(mod - 1) * (mod - 1);
+		return static_cast<size_t>(std::min<ModWide>(~ModWide(0) / sq, SIZE_MAX));
+	}
+};
+
+/**
+ * Plain residues reduced by a 128-bit remainder, for the moduli Montgomery does not take.
+ */
+class ModPlainWide {
+	uint64_t mod;
+public:
+	constexpr explicit ModPlainWide(const uint64_t &m) : mod(m) {}
+	constexpr uint64_t Modulus() const
+	{
+		return mod;
+	}
+	constexpr uint64_t Reduce(const ModWide &t) const
+	{
+		return static_cast<uint64_t>(t % mod);
+	}
+	constexpr size_t Lazy() const
+	{
+		const ModWide sq = ModWide(mod - 1) * (mod - 1);
+		return sq ? static_cast<size_t>(std::min<ModWide>((~ModWide(0) - mod) / sq, SIZE_MAX)) : SIZE_MAX;
+	}
+};
+
+/**
+ * C (M x N) = A (M x K) * B (K x N) mod m, row-major and contiguous, residues below 2^32.
+ */
+template<typename _Red>
+void ModGemm32(const size_t &M, const size_t &N, const size_t &K,
+	const uint32_t *A, const uint32_t *B, uint32_t *C, const _Red &red)
+{
+	const uint64_t m1 = red.Modulus() - 1;
+	// after a reduction a sum is below m, lazy more products keep it below 2^64
+	const size_t lazy = m1 ? static_cast<size_t>(std::min<uint64_t>((UINT64_MAX - m1) / (m1 * m1), K)) : K;
+	// by value: the stores to the sums must not look like they could change the bounds
+	const size_t cols = N, depth = K;
+	ParallelRows(M, N * K, [=, &red](size_t begin, size_t end) {
+		std::vector<uint64_t> row(cols);
+		uint64_t *acc = row.data();
+		for (size_t i = begin; i < end; ++i) {
+			std::fill(acc, acc + cols, 0);
+			const uint32_t *ai = A + i * depth;
+			for (size_t k0 = 0; k0 < depth; k0 += lazy) {
+				const size_t k1 = std::min(depth, k0 + lazy);
+				for (size_t k = k0; k < k1; ++k) {
+					const uint32_t a = ai[k];
+					const uint32_t *bk = B + k * cols;
+					for (size_t j = 0; j < cols; ++j) {
+						acc[j] += uint64_t(a) * bk[j];
+					}
+				}
+				if (k1 < depth) {
+					for (size_t j = 0; j < cols; ++j) {
+						acc[j] = red.Reduce(acc[j]);
+					}
+				}
+			}
+			uint32_t *ci = C + i * cols;
+			for (size_t j = 0; j < cols; ++j) {
+				ci[j] = static_cast<uint32_t>(red.Reduce(acc[j]));
+			}
+		}
+	});
+}
+
+/**
+ * Columns [0, width) of one row of the product, width <= W, the W sums in registers.
+ * Not inlined: inside the row loop GCC runs out of registers and spills the sums.
+ */
+template<size_t W, typename _Red>
+__attribute__((noinline)) void _ModRow64(const size_t &cols, const size_t &depth, const size_t &lazy, const size_t &width,
+	const uint64_t *ai, const uint64_t *B, uint64_t *ci, const _Red &red)
+{
+	const uint64_t m = red.Modulus();
+	uint64_t sum[W] = {};
+	for (size_t k0 = 0; k0 < depth; k0 += lazy) {
+		const size_t k1 = std::min(depth, k0 + lazy);
+		ModWide acc[W] = {};
+		for (size_t k = k0; k < k1; ++k) {
+			const uint64_t a = ai[k], *bk = B + k * cols;
+			for (size_t u = 0; u < W; ++u) {
+				if (u < width) {
+					acc[u] += ModWide(a) * bk[u];
+				}
+			}
+		}
+		for (size_t u = 0; u < width; ++u) {
+			const uint64_t r = red.Reduce(acc[u]);
+			sum[u] = sum[u] >= m - r ? sum[u] - (m - r) : sum[u] + r;
+		}
+	}
+	std::copy(sum, sum + width, ci);
+}
+
+/**
+ * The same with 64-bit residues and 128-bit sums, for ModMontgomery and ModPlainWide.
+ * With Montgomery residues the result is the Montgomery product.
+ */
+template<typename _Red>
+void ModGemm64(const size_t &M, const size_t &N, const size_t &K,
+	const uint64_t *A, const uint64_t *B, uint64_t *C, const _Red &red)
+{
+	const size_t lazy = std::max<size_t>(std::min<size_t>(red.Lazy(), K), 1);
+	ParallelRows(M, N * K, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			for (size_t j = 0; j < N; j += 4) {
+				_ModRow64<4>(N, K, lazy, std::min<size_t>(4, N - j), A + i * K, B + j, C + i * N + j, red);
+			}
+		}
+	});
+}
+
+/**
+ * result = base^e for an n x n matrix of residues; base is overwritten.
+ * one is the residue of 1 in the representation used by mul(c, a, b), which computes c = a * b.
+ * Three buffers are swapped between the steps, none is allocated in the loop.
+ */
+template<typename _Tw, typename _Mul>
+void ModPow(const size_t &n, std::vector<_Tw> &base, size_t e, std::vector<_Tw> &result, const _Tw &one, const _Mul &mul)
+{
+	std::vector<_Tw> work(n * n);
+	bool identity = true;
+	result.assign(n * n, _Tw(0));
+	while (e > 0) {
+		if (e & 1) {
+			if (identity) {
+				result = base;
+				identity = false;
+			}
+			else {
+				mul(work.data(), result.data(), base.data());
+				result.swap(work);
+			}
+		}
+		e >>= 1;
+		if (e > 0) {
+			mul(work.data(), base.data(), base.data());
+			base.swap(work);
+		}
+	}
+	if (identity) {
+		for (size_t i = 0; i < n; ++i) {
+			result[i * n + i] = one;
+		}
+	}
+}
+
+}
+
+}
+#endif
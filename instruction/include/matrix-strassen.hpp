@@ -0,0 +1,140 @@
+#ifndef DIAMOND_MATRIX_STRASSEN_HPP
+#define DIAMOND_MATRIX_STRASSEN_HPP
+
+#include <cstddef>
+#include <algorithm>
+#include "matrix-gemm.hpp"
+
+namespace Diamond {
+
+/**
+ * Strassen-Winograd multiplication: 7 half-size products and 15 additions
+ * instead of 8 products, O(n^2.81) instead of O(n^3).
+ *
+ * Each level splits the even part of M, N and K in halves; an odd last row, column
+ * or inner index is peeled off and added by thin Gemm calls. Products with a side of
+ * at most the cutoff go to Gemm. A level keeps two temporaries, one the size of an
+ * A or C quarter and one of a B quarter, in a single workspace allocated up front:
+ * a third of M * max(K, N) + K * N elements over all levels.
+ *
+ * The result differs from the classical product by rounding. The error bound grows
+ * by about a factor 3 per level instead of staying linear in K, so keep the cutoff
+ * high enough for the accuracy needed. Signed integer types may overflow in the
+ * intermediate sums where the classical product would not.
+ */
+namespace Kernel {
+
+/**
+ * Below this side length Gemm is faster than one more level.
+ */
+const size_t STRASSEN_CUTOFF = 1024;
+
+template<typename _Td>
+void _StrassenSum(const size_t &rows, const size_t &cols, const _Td *x, const size_t &ldx, const _Td *y, const size_t &ldy, _Td *z, const size_t &ldz)
+{
+	for (size_t i = 0; i < rows; ++i) {
+		const _Td *xi = x + i * ldx, *yi = y + i * ldy;
+		_Td *zi = z + i * ldz;
+		for (size_t j = 0; j < cols; ++j) {
+			zi[j] = xi[j] + yi[j];
+		}
+	}
+}
+
+template<typename _Td>
+void _StrassenDiff(const size_t &rows, const size_t &cols, const _Td *x, const size_t &ldx, const _Td *y, const size_t &ldy, _Td *z, const size_t &ldz)
+{
+	for (size_t i = 0; i < rows; ++i) {
+		const _Td *xi = x + i * ldx, *yi = y + i * ldy;
+		_Td *zi = z + i * ldz;
+		for (size_t j = 0; j < cols; ++j) {
+			zi[j] = xi[j] - yi[j];
+		}
+	}
+}
+
+inline bool _StrassenLeaf(const size_t &M, const size_t &N, const size_t &K, const size_t &cutoff)
+{
+	return std::min(std::min(M, N), K) <= std::max(cutoff, size_t(1));
+}
+
+/**
+ * Elements of workspace needed by Strassen for these sizes.
+ */
+inline size_t StrassenWorkspace(const size_t &M, const size_t &N, const size_t &K, const size_t &cutoff)
+{
+	if (_StrassenLeaf(M, N, K, cutoff)) {
+		return 0;
+	}
+	const size_t m = M / 2, n = N / 2, k = K / 2;
+	return m * std::max(k, n) + k * n + StrassenWorkspace(m, n, k, cutoff);
+}
+
+template<typename _Td>
+void _Strassen(const size_t &M, const size_t &N, const size_t &K,
+	const _Td *A, const size_t &lda, const _Td *B, const size_t &ldb, _Td *C, const size_t &ldc,
+	const size_t &cutoff, _Td *work)
+{
+	if (_StrassenLeaf(M, N, K, cutoff)) {
+		Gemm<_Td>(M, N, K, _Td(1), A, lda, 1, B, ldb, 1, _Td(0), C, ldc);
+		return;
+	}
+	const size_t m = M / 2, n = N / 2, k = K / 2;
+	const _Td *A11 = A, *A12 = A + k, *A21 = A + m * lda, *A22 = A21 + k;
+	const _Td *B11 = B, *B12 = B + n, *B21 = B + k * ldb, *B22 = B21 + n;
+	_Td *C11 = C, *C12 = C + n, *C21 = C + m * ldc, *C22 = C21 + n;
+	// X holds an m x k sum, then the m x n product P1; Y holds a k x n sum
+	_Td *X = work, *Y = work + m * std::max(k, n), *rest = Y + k * n;
+
+	_StrassenDiff(m, k, A11, lda, A21, lda, X, k);              // S3 = A11 - A21
+	_StrassenDiff(k, n, B22, ldb, B12, ldb, Y, n);              // T3 = B22 - B12
+	_Strassen(m, n, k, X, k, Y, n, C21, ldc, cutoff, rest);     // P7 = S3 T3
+	_StrassenSum(m, k, A21, lda, A22, lda, X, k);               // S1 = A21 + A22
+	_StrassenDiff(k, n, B12, ldb, B11, ldb, Y, n);              // T1 = B12 - B11
+	_Strassen(m, n, k, X, k, Y, n, C22, ldc, cutoff, rest);     // P5 = S1 T1
+	_StrassenDiff(m, k, X, k, A11, lda, X, k);                  // S2 = S1 - A11
+	_StrassenDiff(k, n, B22, ldb, Y, n, Y, n);                  // T2 = B22 - T1
+	_Strassen(m, n, k, X, k, Y, n, C12, ldc, cutoff, rest);     // P6 = S2 T2
+	_StrassenDiff(m, k, A12, lda, X, k, X, k);                  // S4 = A12 - S2
+	_Strassen(m, n, k, X, k, B22, ldb, C11, ldc, cutoff, rest); // P3 = S4 B22
+	_Strassen(m, n, k, A11, lda, B11, ldb, X, n, cutoff, rest); // P1 = A11 B11
+	_StrassenSum(m, n, X, n, C12, ldc, C12, ldc);               // U2 = P1 + P6
+	_StrassenSum(m, n, C12, ldc, C21, ldc, C21, ldc);           // U3 = U2 + P7
+	_StrassenSum(m, n, C12, ldc, C22, ldc, C12, ldc);           // U4 = U2 + P5
+	_StrassenSum(m, n, C21, ldc, C22, ldc, C22, ldc);           // C22 = U3 + P5
+	_StrassenSum(m, n, C12, ldc, C11, ldc, C12, ldc);           // C12 = U4 + P3
+	_StrassenDiff(k, n, Y, n, B21, ldb, Y, n);                  // T4 = T2 - B21
+	_Strassen(m, n, k, A22, lda, Y, n, C11, ldc, cutoff, rest); // P4 = A22 T4
+	_StrassenDiff(m, n, C21, ldc, C11, ldc, C21, ldc);          // C21 = U3 - P4
+	_Strassen(m, n, k, A12, lda, B21, ldb, C11, ldc, cutoff, rest); // P2 = A12 B21
+	_StrassenSum(m, n, X, n, C11, ldc, C11, ldc);               // C11 = P1 + P2
+
+	// peeled edges: the last inner index, then the last column and the last row
+	if (K & 1) {
+		Gemm<_Td>(2 * m, 2 * n, 1, _Td(1), A + (K - 1), lda, 1, B + (K - 1) * ldb, ldb, 1, _Td(1), C, ldc);
+	}
+	if (N & 1) {
+		Gemm<_Td>(2 * m, 1, K, _Td(1), A, lda, 1, B + (N - 1), ldb, 1, _Td(0), C + (N - 1), ldc);
+	}
+	if (M & 1) {
+		Gemm<_Td>(1, N, K, _Td(1), A + (M - 1) * lda, lda, 1, B, ldb, 1, _Td(0), C + (M - 1) * ldc, ldc);
+	}
+}
+
+/**
+ * C (M x N) = A (M x K) * B (K x N), all row-major with the given leading dimensions.
+ */
+template<typename _Td>
+void Strassen(const size_t &M, const size_t &N, const size_t &K,
+	const _Td *A, const size_t &lda, const _Td *B, const size_t &ldb, _Td *C, const size_t &ldc,
+	const size_t &cutoff = STRASSEN_CUTOFF)
+{
+	static_assert(GemmSupported<_Td>::value, "Strassen needs an arithmetic element type");
+	AlignedBuffer<_Td> work(StrassenWorkspace(M, N, K, cutoff));
+	_Strassen<_Td>(M, N, K, A, lda, B, ldb, C, ldc, cutoff, work.get());
+}
+
+}
+
+}
+#endif
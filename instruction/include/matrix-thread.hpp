@@ -0,0 +1,198 @@
+#ifndef DIAMOND_MATRIX_THREAD_HPP
+#define DIAMOND_MATRIX_THREAD_HPP
+
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Diamond {
+
+/**
+ * Matrix operations large enough to pay for it are split across a pool of threads.
+ * The pool has ThreadCount() - 1 workers, the calling thread does its share as well.
+ * The default of 1 keeps every operation on the calling thread.
+ * The pool runs one job at a time: a thread that calls in while another thread's job is running
+ * does all of its own tasks serially instead of waiting for the pool.
+ * SetThreadCount must not race with running matrix operations.
+ */
+namespace Kernel {
+
+/**
+ * Element-wise work below this many elements per task stays serial.
+ */
+const size_t PARALLEL_MIN_ELEMS = 1 << 15;
+
+class ThreadPool {
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::mutex running;
+	std::condition_variable wake, done;
+	const std::function<void(size_t)> *job = nullptr;
+	size_t n_tasks = 0;
+	std::atomic<size_t> next{0};
+	size_t n_busy = 0;
+	size_t generation = 0;
+	bool stopping = false;
+	std::exception_ptr error;
+
+	static bool & _InsideTask()
+	{
+		static thread_local bool inside = false;
+		return inside;
+	}
+	void _Drain(const std::function<void(size_t)> &f)
+	{
+		bool &inside = _InsideTask();
+		inside = true;
+		for (size_t t = next++; t < n_tasks; t = next++) {
+			try {
+				f(t);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> guard(lock);
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+		}
+		inside = false;
+	}
+	void _Work()
+	{
+		size_t seen = 0;
+		std::unique_lock<std::mutex> guard(lock);
+		for (;;) {
+			wake.wait(guard, [&] { return stopping || generation != seen; });
+			if (stopping) {
+				return;
+			}
+			seen = generation;
+			const std::function<void(size_t)> *f = job;
+			if (!f) {
+				continue;// woke up after the job was over
+			}
+			++n_busy;
+			guard.unlock();
+			_Drain(*f);
+			guard.lock();
+			if (--n_busy == 0) {
+				done.notify_all();
+			}
+		}
+	}
+	void _Stop()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread &w : workers) {
+			w.join();
+		}
+		workers.clear();
+		stopping = false;
+	}
+public:
+	ThreadPool() {}
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool & operator=(const ThreadPool &) = delete;
+	size_t Size() const
+	{
+		return workers.size() + 1;
+	}
+	void Resize(const size_t &n)
+	{
+		_Stop();
+		for (size_t i = 1; i < n; ++i) {
+			workers.emplace_back([this] { _Work(); });
+		}
+	}
+	/**
+	 * Run f(0) ... f(tasks - 1), each exactly once, and return when all are done.
+	 * Calls made from inside a task, or while the pool runs another thread's job, run serially.
+	 * The first exception thrown by a task is rethrown here.
+	 */
+	void Run(const size_t &tasks, const std::function<void(size_t)> &f)
+	{
+		std::unique_lock<std::mutex> owner;
+		if (!workers.empty() && tasks > 1 && !_InsideTask()) {
+			owner = std::unique_lock<std::mutex>(running, std::try_to_lock);
+		}
+		if (!owner.owns_lock()) {
+			for (size_t t = 0; t < tasks; ++t) {
+				f(t);
+			}
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			job = &f;
+			n_tasks = tasks;
+			next = 0;
+			error = nullptr;
+			++generation;
+		}
+		wake.notify_all();
+		_Drain(f);
+		std::unique_lock<std::mutex> guard(lock);
+		done.wait(guard, [&] { return n_busy == 0; });
+		job = nullptr;
+		n_tasks = 0;
+		if (error) {
+			std::exception_ptr e = error;
+			error = nullptr;
+			std::rethrow_exception(e);
+		}
+	}
+	~ThreadPool()
+	{
+		_Stop();
+	}
+};
+
+inline ThreadPool & Pool()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+/**
+ * f(begin, end) over row blocks of a rows x cols operation,
+ * with at least PARALLEL_MIN_ELEMS elements in a block.
+ */
+template<typename _Fn>
+void ParallelRows(const size_t &rows, const size_t &cols, _Fn &&f)
+{
+	const size_t threads = Pool().Size();
+	size_t blocks = cols ? rows * cols / PARALLEL_MIN_ELEMS : 0;
+	blocks = std::min(std::min(blocks, threads), rows);
+	if (blocks <= 1) {
+		f(size_t(0), rows);
+		return;
+	}
+	Pool().Run(blocks, [&](size_t t) {
+		f(rows * t / blocks, rows * (t + 1) / blocks);
+	});
+}
+
+}
+
+inline void SetThreadCount(const size_t &n)
+{
+	Kernel::Pool().Resize(n ? n : 1);
+}
+
+inline size_t ThreadCount()
+{
+	return Kernel::Pool().Size();
+}
+
+}
+#endif
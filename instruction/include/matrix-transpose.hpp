@@ -0,0 +1,327 @@
+#ifndef DIAMOND_MATRIX_TRANSPOSE_HPP
+#define DIAMOND_MATRIX_TRANSPOSE_HPP
+
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+#include "matrix-thread.hpp"
+#include "matrix-gemm.hpp"
+
+namespace Diamond {
+
+/**
+ * Cache-oblivious matrix transposition.
+ *
+ * The longer side is halved until a block fits in L1 on both sides (TRANSPOSE_LEAF),
+ * so reading the source and writing the destination both stay within cached lines
+ * at every level without tuning for a cache size.
+ * Inside a block, 4 and 8 byte types are moved as 4 x 4 (8 byte) or 8 x 8 (4 byte)
+ * tiles transposed in AVX registers; other types, and CPUs without AVX2, are copied
+ * one element at a time.
+ */
+namespace Kernel {
+
+const size_t TRANSPOSE_LEAF = 32;
+
+/**
+ * Generic leaves, one element at a time.
+ */
+template<typename _Td>
+struct ScalarTranspose {
+	static constexpr size_t W = 1;
+	static void Copy(const size_t &rows, const size_t &cols, const _Td *src, const size_t &lds, _Td *dst, const size_t &ldd)
+	{
+		for (size_t i = 0; i < rows; ++i) {
+			for (size_t j = 0; j < cols; ++j) {
+				dst[j * ldd + i] = src[i * lds + j];
+			}
+		}
+	}
+	static void Swap(const size_t &rows, const size_t &cols, _Td *p, const size_t &ldp, _Td *q, const size_t &ldq)
+	{
+		using std::swap;
+		for (size_t i = 0; i < rows; ++i) {
+			for (size_t j = 0; j < cols; ++j) {
+				swap(p[i * ldp + j], q[j * ldq + i]);
+			}
+		}
+	}
+	static void InPlace(const size_t &n, _Td *a, const size_t &lda)
+	{
+		using std::swap;
+		for (size_t i = 0; i < n; ++i) {
+			for (size_t j = i + 1; j < n; ++j) {
+				swap(a[i * lda + j], a[j * lda + i]);
+			}
+		}
+	}
+};
+
+#ifdef DIAMOND_GEMM_X86
+/**
+ * A W x W tile held in W ymm registers, one row in each.
+ */
+template<typename _Td>
+struct _VecTile {
+	static constexpr size_t W = 32 / sizeof(_Td);
+	typedef _Td vec __attribute__((vector_size(32)));
+	typedef _Td uvec __attribute__((vector_size(32), aligned(sizeof(_Td))));
+
+	__attribute__((always_inline)) static inline void Load(const _Td *src, const size_t &ld, vec *r)
+	{
+#pragma GCC unroll 8
+		for (size_t i = 0; i < W; ++i) {
+			r[i] = *reinterpret_cast<const uvec *>(src + i * ld);
+		}
+	}
+	__attribute__((always_inline)) static inline void Store(_Td *dst, const size_t &ld, const vec *r)
+	{
+#pragma GCC unroll 8
+		for (size_t i = 0; i < W; ++i) {
+			*reinterpret_cast<uvec *>(dst + i * ld) = r[i];
+		}
+	}
+	/**
+	 * Unpack pairs, then pairs of pairs, then 128-bit halves.
+	 */
+	__attribute__((always_inline)) static inline void Transpose(vec *r)
+	{
+		if constexpr (W == 4) {
+			const vec t0 = __builtin_shufflevector(r[0], r[1], 0, 4, 2, 6);
+			const vec t1 = __builtin_shufflevector(r[0], r[1], 1, 5, 3, 7);
+			const vec t2 = __builtin_shufflevector(r[2], r[3], 0, 4, 2, 6);
+			const vec t3 = __builtin_shufflevector(r[2], r[3], 1, 5, 3, 7);
+			r[0] = __builtin_shufflevector(t0, t2, 0, 1, 4, 5);
+			r[1] = __builtin_shufflevector(t1, t3, 0, 1, 4, 5);
+			r[2] = __builtin_shufflevector(t0, t2, 2, 3, 6, 7);
+			r[3] = __builtin_shufflevector(t1, t3, 2, 3, 6, 7);
+		}
+		else {
+			vec t[8], u[8];
+#pragma GCC unroll 4
+			for (size_t k = 0; k < 8; k += 2) {
+				t[k] = __builtin_shufflevector(r[k], r[k + 1], 0, 8, 1, 9, 4, 12, 5, 13);
+				t[k + 1] = __builtin_shufflevector(r[k], r[k + 1], 2, 10, 3, 11, 6, 14, 7, 15);
+			}
+#pragma GCC unroll 2
+			for (size_t k = 0; k < 8; k += 4) {
+				u[k] = __builtin_shufflevector(t[k], t[k + 2], 0, 1, 8, 9, 4, 5, 12, 13);
+				u[k + 1] = __builtin_shufflevector(t[k], t[k + 2], 2, 3, 10, 11, 6, 7, 14, 15);
+				u[k + 2] = __builtin_shufflevector(t[k + 1], t[k + 3], 0, 1, 8, 9, 4, 5, 12, 13);
+				u[k + 3] = __builtin_shufflevector(t[k + 1], t[k + 3], 2, 3, 10, 11, 6, 7, 14, 15);
+			}
+#pragma GCC unroll 4
+			for (size_t k = 0; k < 4; ++k) {
+				r[k] = __builtin_shufflevector(u[k], u[k + 4], 0, 1, 2, 3, 8, 9, 10, 11);
+				r[k + 4] = __builtin_shufflevector(u[k], u[k + 4], 4, 5, 6, 7, 12, 13, 14, 15);
+			}
+		}
+	}
+};
+
+/**
+ * The leaves of ScalarTranspose with the full tiles going through registers.
+ */
+template<typename _Td>
+struct Avx2Transpose {
+	typedef _VecTile<_Td> Tile;
+	typedef typename Tile::vec vec;
+	static constexpr size_t W = Tile::W;
+
+	__attribute__((target("avx2"))) __attribute__((noinline))
+	static void Copy(const size_t &rows, const size_t &cols, const _Td *src, const size_t &lds, _Td *dst, const size_t &ldd)
+	{
+		const size_t rf = rows / W * W, cf = cols / W * W;
+		for (size_t i = 0; i < rf; i += W) {
+			for (size_t j = 0; j < cf; j += W) {
+				vec r[W];
+				Tile::Load(src + i * lds + j, lds, r);
+				Tile::Transpose(r);
+				Tile::Store(dst + j * ldd + i, ldd, r);
+			}
+		}
+		ScalarTranspose<_Td>::Copy(rf, cols - cf, src + cf, lds, dst + cf * ldd, ldd);
+		ScalarTranspose<_Td>::Copy(rows - rf, cols, src + rf * lds, lds, dst + rf, ldd);
+	}
+	__attribute__((target("avx2"))) __attribute__((noinline))
+	static void Swap(const size_t &rows, const size_t &cols, _Td *p, const size_t &ldp, _Td *q, const size_t &ldq)
+	{
+		const size_t rf = rows / W * W, cf = cols / W * W;
+		for (size_t i = 0; i < rf; i += W) {
+			for (size_t j = 0; j < cf; j += W) {
+				vec r[W], s[W];
+				Tile::Load(p + i * ldp + j, ldp, r);
+				Tile::Load(q + j * ldq + i, ldq, s);
+				Tile::Transpose(r);
+				Tile::Transpose(s);
+				Tile::Store(q + j * ldq + i, ldq, r);
+				Tile::Store(p + i * ldp + j, ldp, s);
+			}
+		}
+		ScalarTranspose<_Td>::Swap(rf, cols - cf, p + cf, ldp, q + cf * ldq, ldq);
+		ScalarTranspose<_Td>::Swap(rows - rf, cols, p + rf * ldp, ldp, q + rf, ldq);
+	}
+	__attribute__((target("avx2"))) __attribute__((noinline))
+	static void InPlace(const size_t &n, _Td *a, const size_t &lda)
+	{
+		const size_t nf = n / W * W;
+		for (size_t i = 0; i < nf; i += W) {
+			vec r[W], s[W];
+			Tile::Load(a + i * lda + i, lda, r);
+			Tile::Transpose(r);
+			Tile::Store(a + i * lda + i, lda, r);
+			for (size_t j = i + W; j < nf; j += W) {
+				Tile::Load(a + i * lda + j, lda, r);
+				Tile::Load(a + j * lda + i, lda, s);
+				Tile::Transpose(r);
+				Tile::Transpose(s);
+				Tile::Store(a + j * lda + i, lda, r);
+				Tile::Store(a + i * lda + j, lda, s);
+			}
+		}
+		ScalarTranspose<_Td>::Swap(nf, n - nf, a + nf, lda, a + nf * lda, lda);
+		ScalarTranspose<_Td>::InPlace(n - nf, a + nf * lda + nf, lda);
+	}
+};
+#endif
+
+/**
+ * Half of len, rounded down to whole tiles so that only the outer edges have partial ones.
+ */
+inline size_t _TransposeSplit(const size_t &len, const size_t &W)
+{
+	const size_t h = len / 2 / W * W;
+	return h ? h : len / 2;
+}
+
+/**
+ * dst (cols x rows) = src (rows x cols) transposed.
+ */
+template<typename _Td, typename _Ops>
+void _TransposeCopy(const size_t &rows, const size_t &cols, const _Td *src, const size_t &lds, _Td *dst, const size_t &ldd)
+{
+	if (rows <= TRANSPOSE_LEAF && cols <= TRANSPOSE_LEAF) {
+		_Ops::Copy(rows, cols, src, lds, dst, ldd);
+	}
+	else if (rows >= cols) {
+		const size_t h = _TransposeSplit(rows, _Ops::W);
+		_TransposeCopy<_Td, _Ops>(h, cols, src, lds, dst, ldd);
+		_TransposeCopy<_Td, _Ops>(rows - h, cols, src + h * lds, lds, dst + h, ldd);
+	}
+	else {
+		const size_t h = _TransposeSplit(cols, _Ops::W);
+		_TransposeCopy<_Td, _Ops>(rows, h, src, lds, dst, ldd);
+		_TransposeCopy<_Td, _Ops>(rows, cols - h, src + h, lds, dst + h * ldd, ldd);
+	}
+}
+
+/**
+ * Exchange p (rows x cols) with the transpose of q (cols x rows), the two must not overlap.
+ */
+template<typename _Td, typename _Ops>
+void _TransposeSwap(const size_t &rows, const size_t &cols, _Td *p, const size_t &ldp, _Td *q, const size_t &ldq)
+{
+	if (rows <= TRANSPOSE_LEAF && cols <= TRANSPOSE_LEAF) {
+		_Ops::Swap(rows, cols, p, ldp, q, ldq);
+	}
+	else if (rows >= cols) {
+		const size_t h = _TransposeSplit(rows, _Ops::W);
+		_TransposeSwap<_Td, _Ops>(h, cols, p, ldp, q, ldq);
+		_TransposeSwap<_Td, _Ops>(rows - h, cols, p + h * ldp, ldp, q + h, ldq);
+	}
+	else {
+		const size_t h = _TransposeSplit(cols, _Ops::W);
+		_TransposeSwap<_Td, _Ops>(rows, h, p, ldp, q, ldq);
+		_TransposeSwap<_Td, _Ops>(rows, cols - h, p + h, ldp, q + h * ldq, ldq);
+	}
+}
+
+template<typename _Td, typename _Ops>
+void _TransposeInPlace(const size_t &n, _Td *a, const size_t &lda)
+{
+	if (n <= TRANSPOSE_LEAF) {
+		_Ops::InPlace(n, a, lda);
+		return;
+	}
+	const size_t h = _TransposeSplit(n, _Ops::W);
+	_TransposeInPlace<_Td, _Ops>(h, a, lda);
+	_TransposeInPlace<_Td, _Ops>(n - h, a + h * lda + h, lda);
+	_TransposeSwap<_Td, _Ops>(h, n - h, a + h, lda, a + h * lda, lda);
+}
+
+template<typename _Td, typename _Ops>
+void _TransposeCopyParallel(const size_t &rows, const size_t &cols, const _Td *src, const size_t &lds, _Td *dst, const size_t &ldd)
+{
+	ParallelRows(rows, cols, [&](size_t begin, size_t end) {
+		_TransposeCopy<_Td, _Ops>(end - begin, cols, src + begin * lds, lds, dst + begin, ldd);
+	});
+}
+
+/**
+ * The two diagonal blocks and the two halves of the off-diagonal pair are 4 tasks of equal size.
+ */
+template<typename _Td, typename _Ops>
+void _TransposeInPlaceParallel(const size_t &n, _Td *a, const size_t &lda)
+{
+	if (Pool().Size() == 1 || n * n < 2 * PARALLEL_MIN_ELEMS) {
+		_TransposeInPlace<_Td, _Ops>(n, a, lda);
+		return;
+	}
+	const size_t h = _TransposeSplit(n, _Ops::W), q = _TransposeSplit(h, _Ops::W);
+	Pool().Run(4, [&](size_t t) {
+		switch (t) {
+		case 0:
+			_TransposeInPlace<_Td, _Ops>(h, a, lda);
+			break;
+		case 1:
+			_TransposeInPlace<_Td, _Ops>(n - h, a + h * lda + h, lda);
+			break;
+		case 2:
+			_TransposeSwap<_Td, _Ops>(q, n - h, a + h, lda, a + h * lda, lda);
+			break;
+		default:
+			_TransposeSwap<_Td, _Ops>(h - q, n - h, a + q * lda + h, lda, a + h * lda + q, lda);
+			break;
+		}
+	});
+}
+
+/**
+ * dst (cols x rows, leading dimension ldd) = src (rows x cols, leading dimension lds) transposed.
+ * The two must not overlap.
+ */
+template<typename _Td>
+void TransposeCopy(const size_t &rows, const size_t &cols, const _Td *src, const size_t &lds, _Td *dst, const size_t &ldd)
+{
+#ifdef DIAMOND_GEMM_X86
+	if constexpr (GemmVectorizable<_Td>::value) {
+		if (ActiveGemmIsa() != GemmIsa::Scalar) {
+			_TransposeCopyParallel<_Td, Avx2Transpose<_Td>>(rows, cols, src, lds, dst, ldd);
+			return;
+		}
+	}
+#endif
+	_TransposeCopyParallel<_Td, ScalarTranspose<_Td>>(rows, cols, src, lds, dst, ldd);
+}
+
+/**
+ * Transpose the n x n matrix a (leading dimension lda) in place.
+ */
+template<typename _Td>
+void TransposeSquare(const size_t &n, _Td *a, const size_t &lda)
+{
+#ifdef DIAMOND_GEMM_X86
+	if constexpr (GemmVectorizable<_Td>::value) {
+		if (ActiveGemmIsa() != GemmIsa::Scalar) {
+			_TransposeInPlaceParallel<_Td, Avx2Transpose<_Td>>(n, a, lda);
+			return;
+		}
+	}
+#endif
+	_TransposeInPlaceParallel<_Td, ScalarTranspose<_Td>>(n, a, lda);
+}
+
+}
+
+}
+#endif
@@ -0,0 +1,354 @@
+#ifndef DIAMOND_MATRIX_VIEW_HPP
+#define DIAMOND_MATRIX_VIEW_HPP
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include "matrix-thread.hpp"
+#include "matrix-expr.hpp"
+#include "matrix-transpose.hpp"
+
+namespace Diamond {
+
+/**
+ * Views read or write part of a Matrix where it is, without copying it.
+ *
+ * A view is a pointer, a shape and the row stride of the matrix it was taken from:
+ * m.block(r, c, h, w), m.row(i), m.col(j), and views of views the same way.
+ * Transposed(v) reads any of them transposed.
+ * Views are expressions, so they take part in a + b, a * b (read in place by GEMM)
+ * and Matrix construction like matrices do.
+ *
+ * Copying a view copies the handle, assigning to a MatrixView writes its elements.
+ * A view is valid as long as the matrix keeps its buffer, see Matrix::data().
+ */
+template<typename _Td>
+class MatrixView;
+template<typename _Td>
+class TransposedView;
+
+/**
+ * Whether the h1 x w1 elements from p and the h2 x w2 elements from q, rows ld1 and ld2 apart, share one.
+ * Blocks of the same matrix are compared as rectangles, anything else by address ranges.
+ */
+template<typename _Td>
+bool _ViewsOverlap(const _Td *p, const size_t &h1, const size_t &w1, const size_t &ld1,
+	const _Td *q, const size_t &h2, const size_t &w2, const size_t &ld2)
+{
+	if (!h1 || !w1 || !h2 || !w2) {
+		return false;
+	}
+	std::less<const _Td *> less;
+	if (!less(p, q + (h2 - 1) * ld2 + w2) || !less(q, p + (h1 - 1) * ld1 + w1)) {
+		return false;
+	}
+	if (ld1 != ld2) {
+		return true;
+	}
+	// q - p = dr * ld + dc: q starts dc columns right or ld - dc columns left of p
+	const std::ptrdiff_t ld = static_cast<std::ptrdiff_t>(ld1), d = q - p;
+	std::ptrdiff_t dr = d / ld, dc = d % ld;
+	if (dc < 0) {
+		dc += ld;
+		--dr;
+	}
+	auto meets = [&](const std::ptrdiff_t &r, const std::ptrdiff_t &c) {
+		return r < static_cast<std::ptrdiff_t>(h1) && -r < static_cast<std::ptrdiff_t>(h2)
+			&& c < static_cast<std::ptrdiff_t>(w1) && -c < static_cast<std::ptrdiff_t>(w2);
+	};
+	return meets(dr, dc) || meets(dr + 1, dc - ld);
+}
+
+inline void _CheckBlock(const size_t &rows, const size_t &cols, const size_t &r, const size_t &c, const size_t &h, const size_t &w)
+{
+	if (r > rows || h > rows - r || c > cols || w > cols - c) {
+		throw std::out_of_range("the block is out of the matrix");
+	}
+}
+
+/**
+ * Read-only view.
+ */
+template<typename _Td>
+class ConstMatrixView : public MatrixExpr<_Td, ConstMatrixView<_Td>> {
+	const _Td *ptr;
+	size_t n_rows, n_cols, n_stride;
+public:
+	ConstMatrixView(const _Td *_ptr, const size_t &_n_rows, const size_t &_n_cols, const size_t &_n_stride)
+		: ptr(_ptr), n_rows(_n_rows), n_cols(_n_cols), n_stride(_n_stride) {}
+	ConstMatrixView(const Matrix<_Td> &mat)
+		: ptr(mat.data()), n_rows(mat.RowSize()), n_cols(mat.ColSize()), n_stride(mat.stride()) {}
+	size_t RowSize() const
+	{
+		return n_rows;
+	}
+	size_t ColSize() const
+	{
+		return n_cols;
+	}
+	size_t stride() const
+	{
+		return n_stride;
+	}
+	const _Td * data() const
+	{
+		return ptr;
+	}
+	const _Td * operator[](const size_t &Kth) const
+	{
+		return ptr + Kth * n_stride;
+	}
+	const _Td & operator()(const size_t &i, const size_t &j) const
+	{
+		return ptr[i * n_stride + j];
+	}
+	ConstMatrixView<_Td> block(const size_t &r, const size_t &c, const size_t &h, const size_t &w) const
+	{
+		_CheckBlock(n_rows, n_cols, r, c, h, w);
+		return ConstMatrixView<_Td>(ptr + r * n_stride + c, h, w, n_stride);
+	}
+	ConstMatrixView<_Td> row(const size_t &i) const
+	{
+		return block(i, 0, 1, n_cols);
+	}
+	ConstMatrixView<_Td> col(const size_t &j) const
+	{
+		return block(0, j, n_rows, 1);
+	}
+	Matrix<_Td> * Buffer()
+	{
+		return nullptr;
+	}
+	/**
+	 * Reading the destination itself element by element is safe.
+	 */
+	bool Aliases(const ConstMatrixView<_Td> &dst) const
+	{
+		if (ptr == dst.data() && n_stride == dst.stride()) {
+			return false;
+		}
+		return _ViewsOverlap(ptr, n_rows, n_cols, n_stride, dst.data(), dst.RowSize(), dst.ColSize(), dst.stride());
+	}
+};
+
+/**
+ * The transpose of a view, read in place.
+ * A product reads it through swapped strides and a Matrix built from it
+ * is filled by the blocked transpose, neither copies it first.
+ */
+template<typename _Td>
+class TransposedView : public MatrixExpr<_Td, TransposedView<_Td>> {
+	ConstMatrixView<_Td> src;
+public:
+	explicit TransposedView(const ConstMatrixView<_Td> &_src) : src(_src) {}
+	size_t RowSize() const
+	{
+		return src.ColSize();
+	}
+	size_t ColSize() const
+	{
+		return src.RowSize();
+	}
+	/**
+	 * The source is data() with row stride stride(), it has ColSize() rows.
+	 */
+	const _Td * data() const
+	{
+		return src.data();
+	}
+	size_t stride() const
+	{
+		return src.stride();
+	}
+	const _Td & operator()(const size_t &i, const size_t &j) const
+	{
+		return src(j, i);
+	}
+	const ConstMatrixView<_Td> & Source() const
+	{
+		return src;
+	}
+	Matrix<_Td> * Buffer()
+	{
+		return nullptr;
+	}
+	bool Aliases(const ConstMatrixView<_Td> &dst) const
+	{
+		return _ViewsOverlap(src.data(), src.RowSize(), src.ColSize(), src.stride(), dst.data(), dst.RowSize(), dst.ColSize(), dst.stride());
+	}
+};
+
+/**
+ * A view that writes into the matrix.
+ * Its constness is the one of the handle: a const MatrixView still writes the elements.
+ */
+template<typename _Td>
+class MatrixView : public MatrixExpr<_Td, MatrixView<_Td>> {
+	_Td *ptr;
+	size_t n_rows, n_cols, n_stride;
+
+	template<typename _Fn>
+	void _Update(const _Fn &f) const
+	{
+		Kernel::ParallelRows(n_rows, n_cols, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				_Td *line = ptr + i * n_stride;
+				for (size_t j = 0; j < n_cols; ++j) {
+					line[j] = f(line[j], i, j);
+				}
+			}
+		});
+	}
+	template<typename _Ex>
+	void _Assign(const _Ex &expr) const
+	{
+		_Update([&expr](const _Td &, const size_t &i, const size_t &j) { return expr(i, j); });
+	}
+	void _Assign(const TransposedView<_Td> &view) const
+	{
+		Kernel::TransposeCopy(n_cols, n_rows, view.data(), view.stride(), ptr, n_stride);
+	}
+	template<typename _Ex>
+	void _CheckSameShape(const _Ex &expr) const
+	{
+		if (n_rows != expr.RowSize() || n_cols != expr.ColSize()) {
+			throw std::invalid_argument("different matrics\'s sizes");
+		}
+	}
+public:
+	MatrixView(_Td *_ptr, const size_t &_n_rows, const size_t &_n_cols, const size_t &_n_stride)
+		: ptr(_ptr), n_rows(_n_rows), n_cols(_n_cols), n_stride(_n_stride) {}
+	MatrixView(Matrix<_Td> &mat)
+		: ptr(mat.data()), n_rows(mat.RowSize()), n_cols(mat.ColSize()), n_stride(mat.stride()) {}
+	MatrixView(const MatrixView<_Td> &) = default;
+	operator ConstMatrixView<_Td>() const
+	{
+		return ConstMatrixView<_Td>(ptr, n_rows, n_cols, n_stride);
+	}
+	/**
+	 * Write the elements of expr, which must have the shape of the view.
+	 * An expression reading the view at other positions is evaluated into a new matrix first.
+	 */
+	template<typename _Ex>
+	const MatrixView<_Td> & operator=(const MatrixExpr<_Td, _Ex> &expr) const
+	{
+		const _Ex &e = expr.derived();
+		_CheckSameShape(e);
+		if (ExprAliases(e, ConstMatrixView<_Td>(*this))) {
+			const Matrix<_Td> tmp(e);
+			_Assign(tmp);
+		}
+		else {
+			_Assign(e);
+		}
+		return *this;
+	}
+	const MatrixView<_Td> & operator=(const MatrixView<_Td> &rhs) const
+	{
+		return *this = static_cast<const MatrixExpr<_Td, MatrixView<_Td>> &>(rhs);
+	}
+	template<typename _Ex>
+	const MatrixView<_Td> & operator+=(const MatrixExpr<_Td, _Ex> &expr) const
+	{
+		const _Ex &e = expr.derived();
+		_CheckSameShape(e);
+		if (ExprAliases(e, ConstMatrixView<_Td>(*this))) {
+			return *this += Matrix<_Td>(e);
+		}
+		_Update([&e](const _Td &x, const size_t &i, const size_t &j) { return x + e(i, j); });
+		return *this;
+	}
+	template<typename _Ex>
+	const MatrixView<_Td> & operator-=(const MatrixExpr<_Td, _Ex> &expr) const
+	{
+		const _Ex &e = expr.derived();
+		_CheckSameShape(e);
+		if (ExprAliases(e, ConstMatrixView<_Td>(*this))) {
+			return *this -= Matrix<_Td>(e);
+		}
+		_Update([&e](const _Td &x, const size_t &i, const size_t &j) { return x - e(i, j); });
+		return *this;
+	}
+	const MatrixView<_Td> & operator*=(const _Td &b) const
+	{
+		_Update([&b](const _Td &x, const size_t &, const size_t &) { return x * b; });
+		return *this;
+	}
+	const MatrixView<_Td> & operator/=(const double &b) const
+	{
+		_Update([&b](const _Td &x, const size_t &, const size_t &) { return x / b; });
+		return *this;
+	}
+	size_t RowSize() const
+	{
+		return n_rows;
+	}
+	size_t ColSize() const
+	{
+		return n_cols;
+	}
+	size_t stride() const
+	{
+		return n_stride;
+	}
+	_Td * data() const
+	{
+		return ptr;
+	}
+	_Td * operator[](const size_t &Kth) const
+	{
+		return ptr + Kth * n_stride;
+	}
+	_Td & operator()(const size_t &i, const size_t &j) const
+	{
+		return ptr[i * n_stride + j];
+	}
+	MatrixView<_Td> block(const size_t &r, const size_t &c, const size_t &h, const size_t &w) const
+	{
+		_CheckBlock(n_rows, n_cols, r, c, h, w);
+		return MatrixView<_Td>(ptr + r * n_stride + c, h, w, n_stride);
+	}
+	MatrixView<_Td> row(const size_t &i) const
+	{
+		return block(i, 0, 1, n_cols);
+	}
+	MatrixView<_Td> col(const size_t &j) const
+	{
+		return block(0, j, n_rows, 1);
+	}
+	Matrix<_Td> * Buffer()
+	{
+		return nullptr;
+	}
+	bool Aliases(const ConstMatrixView<_Td> &dst) const
+	{
+		return ConstMatrixView<_Td>(*this).Aliases(dst);
+	}
+};
+
+template<typename _Td>
+TransposedView<_Td> Transposed(const Matrix<_Td> &mat)
+{
+	return TransposedView<_Td>(ConstMatrixView<_Td>(mat));
+}
+
+template<typename _Td>
+TransposedView<_Td> Transposed(const ConstMatrixView<_Td> &view)
+{
+	return TransposedView<_Td>(view);
+}
+
+template<typename _Td>
+TransposedView<_Td> Transposed(const MatrixView<_Td> &view)
+{
+	return TransposedView<_Td>(ConstMatrixView<_Td>(view));
+}
+
+template<typename _Td>
+ConstMatrixView<_Td> Transposed(const TransposedView<_Td> &view)
+{
+	return view.Source();
+}
+
+}
+#endif
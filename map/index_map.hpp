@@ -0,0 +1,693 @@
+/**
+ * implement a container like std::map
+ *   whose nodes live in a few arrays of doubling size and link each other by 32-bit indices.
+ */
+#ifndef SJTU_INDEX_MAP_HPP
+#define SJTU_INDEX_MAP_HPP
+
+// only for std::less<T>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include "utility.hpp"
+#include "exceptions.hpp"
+
+namespace sjtu {
+
+/**
+ * an ordered map with the interface of sjtu::map, except that there are no node handles
+ *   (extract, insert of a node, merge), no erase by key and no equal_range.
+ * a node costs sizeof(value_type) + 12 bytes:
+ *   three 32-bit links, the color is kept in the highest bit of the parent index.
+ * nodes are placed in allocation order, so a map built by consecutive inserts
+ *   is walked through neighbouring memory; erased slots are reused first.
+ * the slots come in chunks of 16, 32, 64, ... that are never moved,
+ *   so references to elements stay valid until the element is erased.
+ * at most 2^31 - 2 elements can be stored.
+ */
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>
+> class index_map {
+public:
+	typedef pair<const Key, T> value_type;
+
+private:
+	typedef std::uint32_t index_t;
+	static const index_t NIL = 0;// slot 0 is the black nil node, also used as end()
+	static const index_t COLOR_BIT = 0x80000000u;
+	static const index_t MAX_NODES = 0x7fffffffu;
+	static const bool RED_NODE = 0;
+	static const bool BLACK_NODE = 1;
+	static const int FIRST_CHUNK_BITS = 4;// chunk c holds the slots [16 (2^c - 1), 16 (2^(c+1) - 1))
+
+	struct Node
+	{
+		union { value_type data; };// only constructed in used slots
+		index_t left, right;
+		index_t parent_color;
+		Node() :left(NIL), right(NIL), parent_color(COLOR_BIT){}
+		~Node(){}
+		index_t parent() const { return parent_color & ~COLOR_BIT; }
+		void set_parent(index_t node) { parent_color = node | (parent_color & COLOR_BIT); }
+		bool color() const { return parent_color & COLOR_BIT; }
+		void set_color(bool color) { parent_color = (parent_color & ~COLOR_BIT) | (color ? COLOR_BIT : 0); }
+	};
+	Node *chunks[32 - FIRST_CHUNK_BITS];
+	index_t n_chunks;
+	index_t used;// slots [0, used) have been handed out
+	index_t max_nodes;// slots in the chunks
+	index_t free_head;// erased slots chained by left
+	index_t root;
+	size_t node_size;
+	Compare cmp;
+
+	Node &slot(index_t node) const
+	{
+		const index_t shifted = node + (index_t(1) << FIRST_CHUNK_BITS);
+		const int top = 31 - __builtin_clz(shifted);
+		return chunks[top - FIRST_CHUNK_BITS][shifted - (index_t(1) << top)];
+	}
+
+	index_t &left(index_t node) { return slot(node).left; }
+	index_t &right(index_t node) { return slot(node).right; }
+	index_t parent(index_t node) const { return slot(node).parent(); }
+	bool color(index_t node) const { return slot(node).color(); }
+	const Key &key(index_t node) const { return slot(node).data.first; }
+
+	void add_chunk()
+	{
+		const index_t capa = index_t(1) << (n_chunks + FIRST_CHUNK_BITS);
+		chunks[n_chunks] = static_cast<Node *>(::operator new(sizeof(Node) * capa));
+		n_chunks++;
+		max_nodes += capa;
+	}
+
+	void reserve_slots(index_t capa)
+	{
+		while (max_nodes < capa) add_chunk();
+	}
+
+	void release_chunks()
+	{
+		for (index_t i = 0; i < n_chunks; ++i) ::operator delete(chunks[i]);
+		n_chunks = 0;
+		max_nodes = 0;
+	}
+
+	void destroy_data(index_t node)
+	{
+		if (node == NIL) return;
+		destroy_data(slot(node).left);
+		destroy_data(slot(node).right);
+		slot(node).data.~value_type();
+	}
+
+	index_t new_node(const value_type &value)
+	{
+		index_t node = free_head;
+		if (node == NIL)
+		{
+			if (used == MAX_NODES) throw runtime_error("index_map is full.");
+			if (used == max_nodes) add_chunk();
+			node = used;
+			new (&slot(node)) Node();
+		}
+		// the slot is only taken once the element is built, a throwing copy leaves the map as it was
+		new (&slot(node).data) value_type(value);
+		if (node == free_head) free_head = slot(node).left;
+		else used++;
+		slot(node).left = slot(node).right = NIL;
+		slot(node).parent_color = NIL;
+		return node;
+	}
+
+	void free_node(index_t node)
+	{
+		slot(node).data.~value_type();
+		slot(node).left = free_head;
+		free_head = node;
+	}
+
+	/**
+	 * copy the subtree of other rooted at other_node in pre-order,
+	 *   so the copy is laid out compactly whatever the holes in other are.
+	 */
+	index_t copy_node(const index_map &other, index_t other_node, index_t parent_node)
+	{
+		if (other_node == NIL) return NIL;
+		index_t node = new_node(other.slot(other_node).data);
+		slot(node).parent_color = other.slot(other_node).parent_color;
+		slot(node).set_parent(parent_node);
+		index_t son = copy_node(other, other.slot(other_node).left, node);
+		left(node) = son;
+		son = copy_node(other, other.slot(other_node).right, node);
+		right(node) = son;
+		return node;
+	}
+
+	/**
+	 * copy other into this empty map.
+	 * if an element fails to copy, the ones already copied, in slots 1 to used - 1, are destroyed
+	 *   and this stays empty.
+	 */
+	void copy_from(const index_map &other)
+	{
+		try
+		{
+			root = copy_node(other, other.root, NIL);
+		}
+		catch (...)
+		{
+			for (index_t i = 1; i < used; ++i) slot(i).data.~value_type();
+			reset();
+			throw;
+		}
+		node_size = other.node_size;
+	}
+
+	void reset()
+	{
+		new (&slot(NIL)) Node();
+		used = 1;
+		free_head = NIL;
+		root = NIL;
+		node_size = 0;
+	}
+
+	template<class K>
+	index_t find_node(const K &k) const
+	{
+		index_t node = root;
+		while (node != NIL)
+		{
+			if (cmp(k, key(node))) node = slot(node).left;
+			else if (cmp(key(node), k)) node = slot(node).right;
+			else return node;
+		}
+		return NIL;
+	}
+
+	template<class K>
+	index_t lower_node(const K &k) const
+	{
+		index_t node = root, ans = NIL;
+		while (node != NIL)
+		{
+			if (!cmp(key(node), k)) { ans = node; node = slot(node).left; }
+			else node = slot(node).right;
+		}
+		return ans;
+	}
+
+	template<class K>
+	index_t upper_node(const K &k) const
+	{
+		index_t node = root, ans = NIL;
+		while (node != NIL)
+		{
+			if (cmp(k, key(node))) { ans = node; node = slot(node).left; }
+			else node = slot(node).right;
+		}
+		return ans;
+	}
+
+	index_t minimum(index_t node) const
+	{
+		while (slot(node).left != NIL) node = slot(node).left;
+		return node;
+	}
+
+	index_t maximum(index_t node) const
+	{
+		while (slot(node).right != NIL) node = slot(node).right;
+		return node;
+	}
+
+	index_t next_node(index_t node) const
+	{
+		if (slot(node).right != NIL) return minimum(slot(node).right);
+		index_t father = parent(node);
+		while (father != NIL && node == slot(father).right)
+		{
+			node = father;
+			father = parent(node);
+		}
+		return father;
+	}
+
+	index_t prev_node(index_t node) const
+	{
+		if (slot(node).left != NIL) return maximum(slot(node).left);
+		index_t father = parent(node);
+		while (father != NIL && node == slot(father).left)
+		{
+			node = father;
+			father = parent(node);
+		}
+		return father;
+	}
+
+	void rotate_left(index_t x)
+	{
+		index_t y = right(x);
+		right(x) = left(y);
+		if (left(y) != NIL) slot(left(y)).set_parent(x);
+		slot(y).set_parent(parent(x));
+		if (parent(x) == NIL) root = y;
+		else if (x == left(parent(x))) left(parent(x)) = y;
+		else right(parent(x)) = y;
+		left(y) = x;
+		slot(x).set_parent(y);
+	}
+
+	void rotate_right(index_t x)
+	{
+		index_t y = left(x);
+		left(x) = right(y);
+		if (right(y) != NIL) slot(right(y)).set_parent(x);
+		slot(y).set_parent(parent(x));
+		if (parent(x) == NIL) root = y;
+		else if (x == right(parent(x))) right(parent(x)) = y;
+		else left(parent(x)) = y;
+		right(y) = x;
+		slot(x).set_parent(y);
+	}
+
+	void insert_fixup(index_t z)
+	{
+		while (color(parent(z)) == RED_NODE)
+		{
+			index_t father = parent(z), grand = parent(father);
+			if (father == left(grand))
+			{
+				index_t uncle = right(grand);
+				if (color(uncle) == RED_NODE)
+				{
+					slot(father).set_color(BLACK_NODE);
+					slot(uncle).set_color(BLACK_NODE);
+					slot(grand).set_color(RED_NODE);
+					z = grand;
+				}
+				else
+				{
+					if (z == right(father)) { z = father; rotate_left(z); }
+					slot(parent(z)).set_color(BLACK_NODE);
+					slot(grand).set_color(RED_NODE);
+					rotate_right(grand);
+				}
+			}
+			else
+			{
+				index_t uncle = left(grand);
+				if (color(uncle) == RED_NODE)
+				{
+					slot(father).set_color(BLACK_NODE);
+					slot(uncle).set_color(BLACK_NODE);
+					slot(grand).set_color(RED_NODE);
+					z = grand;
+				}
+				else
+				{
+					if (z == left(father)) { z = father; rotate_right(z); }
+					slot(parent(z)).set_color(BLACK_NODE);
+					slot(grand).set_color(RED_NODE);
+					rotate_left(grand);
+				}
+			}
+		}
+		slot(root).set_color(BLACK_NODE);
+	}
+
+	/**
+	 * put v in the place of u, v may be NIL whose parent is set anyway.
+	 */
+	void transplant(index_t u, index_t v)
+	{
+		if (parent(u) == NIL) root = v;
+		else if (u == left(parent(u))) left(parent(u)) = v;
+		else right(parent(u)) = v;
+		slot(v).set_parent(parent(u));
+	}
+
+	void erase_fixup(index_t x)
+	{
+		while (x != root && color(x) == BLACK_NODE)
+		{
+			index_t father = parent(x);
+			if (x == left(father))
+			{
+				index_t w = right(father);
+				if (color(w) == RED_NODE)
+				{
+					slot(w).set_color(BLACK_NODE);
+					slot(father).set_color(RED_NODE);
+					rotate_left(father);
+					w = right(father);
+				}
+				if (color(left(w)) == BLACK_NODE && color(right(w)) == BLACK_NODE)
+				{
+					slot(w).set_color(RED_NODE);
+					x = father;
+				}
+				else
+				{
+					if (color(right(w)) == BLACK_NODE)
+					{
+						slot(left(w)).set_color(BLACK_NODE);
+						slot(w).set_color(RED_NODE);
+						rotate_right(w);
+						w = right(father);
+					}
+					slot(w).set_color(color(father));
+					slot(father).set_color(BLACK_NODE);
+					slot(right(w)).set_color(BLACK_NODE);
+					rotate_left(father);
+					x = root;
+				}
+			}
+			else
+			{
+				index_t w = left(father);
+				if (color(w) == RED_NODE)
+				{
+					slot(w).set_color(BLACK_NODE);
+					slot(father).set_color(RED_NODE);
+					rotate_right(father);
+					w = left(father);
+				}
+				if (color(left(w)) == BLACK_NODE && color(right(w)) == BLACK_NODE)
+				{
+					slot(w).set_color(RED_NODE);
+					x = father;
+				}
+				else
+				{
+					if (color(left(w)) == BLACK_NODE)
+					{
+						slot(right(w)).set_color(BLACK_NODE);
+						slot(w).set_color(RED_NODE);
+						rotate_left(w);
+						w = left(father);
+					}
+					slot(w).set_color(color(father));
+					slot(father).set_color(BLACK_NODE);
+					slot(left(w)).set_color(BLACK_NODE);
+					rotate_right(father);
+					x = root;
+				}
+			}
+		}
+		slot(x).set_color(BLACK_NODE);
+	}
+
+	void erase_node(index_t z)
+	{
+		index_t y = z, x;
+		bool y_color = color(y);
+		if (left(z) == NIL) { x = right(z); transplant(z, right(z)); }
+		else if (right(z) == NIL) { x = left(z); transplant(z, left(z)); }
+		else
+		{
+			y = minimum(right(z));
+			y_color = color(y);
+			x = right(y);
+			if (parent(y) == z) slot(x).set_parent(y);
+			else
+			{
+				transplant(y, right(y));
+				right(y) = right(z);
+				slot(right(y)).set_parent(y);
+			}
+			transplant(z, y);
+			left(y) = left(z);
+			slot(left(y)).set_parent(y);
+			slot(y).set_color(color(z));
+		}
+		if (y_color == BLACK_NODE) erase_fixup(x);
+		slot(NIL).set_parent(NIL);
+		free_node(z);
+		node_size--;
+	}
+
+public:
+	class const_iterator;
+	class iterator {
+		friend class index_map;
+		friend class const_iterator;
+		index_map *owner;
+		index_t itr;
+	public:
+		iterator() :owner(NULL), itr(NIL){}
+		iterator(index_map *other_owner, index_t other_itr) :owner(other_owner), itr(other_itr){}
+		/**
+		 * throw invalid_iterator on end()++ and begin()--
+		 */
+		iterator & operator++()
+		{
+			if (!owner || itr == NIL) throw invalid_iterator();
+			itr = owner->next_node(itr);
+			return *this;
+		}
+		iterator operator++(int)
+		{
+			iterator ans(*this);
+			++*this;
+			return ans;
+		}
+		iterator & operator--()
+		{
+			if (!owner) throw invalid_iterator();
+			index_t ans = (itr == NIL ? (owner->root == NIL ? NIL : owner->maximum(owner->root)) : owner->prev_node(itr));
+			if (ans == NIL) throw invalid_iterator();
+			itr = ans;
+			return *this;
+		}
+		iterator operator--(int)
+		{
+			iterator ans(*this);
+			--*this;
+			return ans;
+		}
+		value_type & operator*() const { return owner->slot(itr).data; }
+		value_type * operator->() const noexcept { return &(owner->slot(itr).data); }
+		bool operator==(const iterator &rhs) const { return owner == rhs.owner && itr == rhs.itr; }
+		bool operator==(const const_iterator &rhs) const { return owner == rhs.owner && itr == rhs.itr; }
+		bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+		bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
+	};
+	class const_iterator {
+		friend class index_map;
+		friend class iterator;
+		const index_map *owner;
+		index_t itr;
+	public:
+		const_iterator() :owner(NULL), itr(NIL){}
+		const_iterator(const index_map *other_owner, index_t other_itr) :owner(other_owner), itr(other_itr){}
+		const_iterator(const iterator &other) :owner(other.owner), itr(other.itr){}
+		const_iterator & operator++()
+		{
+			if (!owner || itr == NIL) throw invalid_iterator();
+			itr = owner->next_node(itr);
+			return *this;
+		}
+		const_iterator operator++(int)
+		{
+			const_iterator ans(*this);
+			++*this;
+			return ans;
+		}
+		const_iterator & operator--()
+		{
+			if (!owner) throw invalid_iterator();
+			index_t ans = (itr == NIL ? (owner->root == NIL ? NIL : owner->maximum(owner->root)) : owner->prev_node(itr));
+			if (ans == NIL) throw invalid_iterator();
+			itr = ans;
+			return *this;
+		}
+		const_iterator operator--(int)
+		{
+			const_iterator ans(*this);
+			--*this;
+			return ans;
+		}
+		const value_type & operator*() const { return owner->slot(itr).data; }
+		const value_type * operator->() const noexcept { return &(owner->slot(itr).data); }
+		bool operator==(const iterator &rhs) const { return owner == rhs.owner && itr == rhs.itr; }
+		bool operator==(const const_iterator &rhs) const { return owner == rhs.owner && itr == rhs.itr; }
+		bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+		bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
+	};
+
+	index_map() :n_chunks(0), max_nodes(0)
+	{
+		add_chunk();
+		reset();
+	}
+	/**
+	 * builds an empty map first, so the destructor releases the chunks if copying throws.
+	 */
+	index_map(const index_map &other) :index_map()
+	{
+		reserve_slots(static_cast<index_t>(other.node_size + 1));
+		copy_from(other);
+	}
+	index_map & operator=(const index_map &other)
+	{
+		if (this == &other) return *this;
+		clear();
+		reserve_slots(static_cast<index_t>(other.node_size + 1));
+		copy_from(other);
+		return *this;
+	}
+	~index_map()
+	{
+		destroy_data(root);
+		release_chunks();
+	}
+	/**
+	 * make room for n elements, so that the next inserts allocate nothing.
+	 */
+	void reserve(size_t n)
+	{
+		if (n >= MAX_NODES) throw runtime_error("index_map is full.");
+		reserve_slots(static_cast<index_t>(n + 1));
+	}
+	/**
+	 * access specified element with bounds checking,
+	 *   throw index_out_of_bound if no such element exists.
+	 */
+	T & at(const Key &key)
+	{
+		index_t target = find_node(key);
+		if (target == NIL) throw index_out_of_bound();
+		return slot(target).data.second;
+	}
+	const T & at(const Key &key) const
+	{
+		index_t target = find_node(key);
+		if (target == NIL) throw index_out_of_bound();
+		return slot(target).data.second;
+	}
+	/**
+	 * the overloads templated on K take any key type comparable with Key,
+	 *   they are only available when Compare::is_transparent exists (like std::less<>).
+	 */
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	T & at(const K &key)
+	{
+		index_t target = find_node(key);
+		if (target == NIL) throw index_out_of_bound();
+		return slot(target).data.second;
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const T & at(const K &key) const
+	{
+		index_t target = find_node(key);
+		if (target == NIL) throw index_out_of_bound();
+		return slot(target).data.second;
+	}
+	/**
+	 * access specified element, performing an insertion if such key does not already exist.
+	 */
+	T & operator[](const Key &key)
+	{
+		index_t target = find_node(key);
+		if (target != NIL) return slot(target).data.second;
+		return insert(value_type(key, T())).first->second;
+	}
+	/**
+	 * behave like at() throw index_out_of_bound if such key does not exist.
+	 */
+	const T & operator[](const Key &key) const { return at(key); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	T & operator[](const K &key)
+	{
+		index_t target = find_node(key);
+		if (target != NIL) return slot(target).data.second;
+		return insert(value_type(Key(key), T())).first->second;
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const T & operator[](const K &key) const { return at(key); }
+	iterator begin() { return iterator(this, root == NIL ? NIL : minimum(root)); }
+	const_iterator cbegin() const { return const_iterator(this, root == NIL ? NIL : minimum(root)); }
+	iterator end() { return iterator(this, NIL); }
+	const_iterator cend() const { return const_iterator(this, NIL); }
+	bool empty() const { return node_size == 0; }
+	size_t size() const { return node_size; }
+	/**
+	 * clears the contents, the chunks are kept for reuse.
+	 */
+	void clear()
+	{
+		destroy_data(root);
+		reset();
+	}
+	/**
+	 * insert an element.
+	 * return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 */
+	pair<iterator, bool> insert(const value_type &value)
+	{
+		index_t father = NIL, node = root;
+		bool go_left = false;
+		while (node != NIL)
+		{
+			father = node;
+			if (cmp(value.first, key(node))) { go_left = true; node = slot(node).left; }
+			else if (cmp(key(node), value.first)) { go_left = false; node = slot(node).right; }
+			else return pair<iterator, bool>(iterator(this, node), false);
+		}
+		index_t z = new_node(value);
+		slot(z).set_parent(father);
+		slot(z).set_color(RED_NODE);
+		if (father == NIL) root = z;
+		else if (go_left) left(father) = z;
+		else right(father) = z;
+		node_size++;
+		insert_fixup(z);
+		return pair<iterator, bool>(iterator(this, z), true);
+	}
+	/**
+	 * erase the element at pos.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	void erase(iterator pos)
+	{
+		if (pos.owner != this || pos.itr == NIL) throw index_out_of_bound();
+		erase_node(pos.itr);
+	}
+	size_t count(const Key &key) const { return find_node(key) == NIL ? 0 : 1; }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	size_t count(const K &key) const { return find_node(key) == NIL ? 0 : 1; }
+	iterator find(const Key &key) { return iterator(this, find_node(key)); }
+	const_iterator find(const Key &key) const { return const_iterator(this, find_node(key)); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator find(const K &key) { return iterator(this, find_node(key)); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator find(const K &key) const { return const_iterator(this, find_node(key)); }
+	/**
+	 * the first element not less than key / greater than key, end() if there is none.
+	 */
+	iterator lower_bound(const Key &key) { return iterator(this, lower_node(key)); }
+	const_iterator lower_bound(const Key &key) const { return const_iterator(this, lower_node(key)); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator lower_bound(const K &key) { return iterator(this, lower_node(key)); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator lower_bound(const K &key) const { return const_iterator(this, lower_node(key)); }
+	iterator upper_bound(const Key &key) { return iterator(this, upper_node(key)); }
+	const_iterator upper_bound(const Key &key) const { return const_iterator(this, upper_node(key)); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator upper_bound(const K &key) { return iterator(this, upper_node(key)); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator upper_bound(const K &key) const { return const_iterator(this, upper_node(key)); }
+};
+
+}
+
+#endif
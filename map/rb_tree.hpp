@@ -0,0 +1,1253 @@
+/**
+ * the red-black tree shared by the ordered containers:
+ *   sjtu::map, sjtu::multimap, sjtu::set and sjtu::multiset.
+ */
+#ifndef SJTU_RB_TREE_HPP
+#define SJTU_RB_TREE_HPP
+
+// only for std::less<T>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include "utility.hpp"
+#include "exceptions.hpp"
+#define RED 0
+#define BLACK 1
+#define LEFT 0
+#define RIGHT 1
+
+namespace sjtu {
+
+/**
+ * node layouts of the red-black tree.
+ * plain_layout keeps the color in its own field.
+ * packed_layout stores the color in the lowest bit of the parent pointer,
+ *   which is always 0 since nodes are aligned to pointers,
+ *   and saves one word per node.
+ */
+struct plain_layout {};
+struct packed_layout {};
+
+template<class Node, class Layout> struct rb_links;
+
+template<class Node>
+struct rb_links<Node, plain_layout>
+{
+	Node *left, *right;
+	rb_links() :left(NULL), right(NULL), parent_node(NULL), node_color(RED){}
+	Node *parent() const { return parent_node; }
+	void set_parent(Node *node) { parent_node = node; }
+	bool color() const { return node_color; }
+	void set_color(bool color) { node_color = color; }
+private:
+	Node *parent_node;
+	bool node_color;
+};
+
+template<class Node>
+struct rb_links<Node, packed_layout>
+{
+	Node *left, *right;
+	rb_links() :left(NULL), right(NULL), parent_color(RED){}
+	Node *parent() const { return reinterpret_cast<Node *>(parent_color & ~static_cast<std::uintptr_t>(1)); }
+	void set_parent(Node *node) { parent_color = reinterpret_cast<std::uintptr_t>(node) | (parent_color & 1); }
+	bool color() const { return parent_color & 1; }
+	void set_color(bool color) { parent_color = (parent_color & ~static_cast<std::uintptr_t>(1)) | color; }
+private:
+	std::uintptr_t parent_color;
+};
+
+/**
+ * how the tree gets the key out of a stored element.
+ * maps store pair<const Key, T> and compare the first member,
+ *   sets store the key itself.
+ */
+template<class Pair>
+struct select_first
+{
+	const typename std::remove_const<decltype(static_cast<Pair *>(NULL)->first)>::type & operator()(const Pair &value) const { return value.first; }
+};
+
+template<class Value>
+struct identity
+{
+	const Value & operator()(const Value &value) const { return value; }
+};
+
+/**
+ * a red-black tree of Value ordered by the Key that KeyOfValue extracts.
+ * if Unique is true an element is only inserted when its key is not in the tree yet,
+ *   otherwise equal keys are kept in the order they were inserted.
+ */
+template<
+	class Key,
+	class Value,
+	class KeyOfValue,
+	class Compare,
+	bool Unique,
+	class Layout = plain_layout
+> class rb_tree {
+public:
+	typedef Key key_type;
+	typedef Value value_type;
+	typedef Compare key_compare;
+	typedef std::integral_constant<bool, Unique> is_unique;
+
+protected:
+	struct Node : rb_links<Node, Layout>
+	{
+		union { value_type data; };// left unconstructed in the end sentinel
+		Node(const value_type &other) :data(other){}
+		Node(){ this->set_color(BLACK); }
+		~Node(){}
+	};
+	Node *root;
+	Node *end_node;
+	size_t node_size;
+	Compare cmp;
+
+	Node *copy_node(Node *&node, Node *parent_node, Node *other_node)
+	{
+		if (!other_node) {node = NULL; return NULL;}
+		node = new Node(other_node->data);
+		node->set_parent(parent_node);
+		node->set_color(other_node->color());
+		node->left = copy_node(node->left, node, other_node->left);
+		node->right = copy_node(node->right, node, other_node->right);
+		return node;
+	}
+
+	static const Key & key_of(const Node *node)
+	{
+		return KeyOfValue()(node->data);
+	}
+
+	static void free_node(Node *node)
+	{
+		node->data.~value_type();
+		delete node;
+	}
+
+	void destroy_node(Node *&node)
+	{
+		if (!node) return;
+		destroy_node(node->left);
+		destroy_node(node->right);
+		free_node(node);
+		node = NULL;
+		node_size--;
+	}
+
+	/**
+	 * the lookup helpers take any key type the comparator accepts,
+	 *   the public templated overloads only forward to them for transparent comparators.
+	 * find_node stops at any equal key, first_node returns the first one of equal keys.
+	 */
+	template<class K>
+	Node *find_node(const K &key, Node *node)
+	{
+		if (!node) return NULL;
+		if (!cmp(key_of(node), key) && !cmp(key, key_of(node)))
+            return node;
+		else
+		{
+			if (!cmp(key, key_of(node)))
+				return find_node(key, node->right);
+			else
+				return find_node(key, node->left);
+		}
+	}
+
+	template<class K>
+	const Node *find_node(const K &key, Node *node) const
+	{
+		if (!node) return NULL;
+		if (!cmp(key_of(node), key) && !cmp(key, key_of(node))) return node;
+		else
+		{
+			if (!cmp(key, key_of(node)))
+				return find_node(key, node->right);
+			else
+				return find_node(key, node->left);
+		}
+	}
+
+	/**
+	 * the first node not less than key, NULL if there is none.
+	 */
+	template<class K>
+	Node *lower_node(const K &key) const
+	{
+		Node *node = root, *ans = NULL;
+		while (node)
+		{
+			if (!cmp(key_of(node), key)) {ans = node; node = node->left;}
+			else node = node->right;
+		}
+		return ans;
+	}
+
+	/**
+	 * the first node greater than key, NULL if there is none.
+	 */
+	template<class K>
+	Node *upper_node(const K &key) const
+	{
+		Node *node = root, *ans = NULL;
+		while (node)
+		{
+			if (cmp(key, key_of(node))) {ans = node; node = node->left;}
+			else node = node->right;
+		}
+		return ans;
+	}
+
+	template<class K>
+	Node *first_node(const K &key) const
+	{
+		Node *node = root, *ans = NULL;
+		while (node)
+		{
+			if (cmp(key, key_of(node))) node = node->left;
+			else if (cmp(key_of(node), key)) node = node->right;
+			else
+			{
+				if (Unique) return node;
+				ans = node; node = node->left;
+			}
+		}
+		return ans;
+	}
+
+	/**
+	 * equal keys go to the right, so a new element is put after the equal ones.
+	 */
+	Node *find_insert_parent(const Key &key, Node *node)
+	{
+		if (!cmp(key, key_of(node)))
+		{
+			if (node->right) return find_insert_parent(key, node->right);
+			else return node;
+		}
+		else
+		{
+			if (node->left) return find_insert_parent(key, node->left);
+			else return node;
+		}
+	}
+
+	void LLb(Node *node)
+	{
+		Node *tmp1, *tmp2, *tmp3, *tmp4;
+		tmp1 = node; tmp2 = node->left; tmp3 = node->right; tmp4 = node->left->left;
+		tmp2->set_parent(tmp1->parent());
+		if (tmp1->parent())
+		{
+			if (return_identity(tmp1) == LEFT) tmp2->parent()->left = tmp2;
+			else tmp2->parent()->right = tmp2;
+		}
+		else root = tmp2;
+		tmp1->left = tmp2->right;
+		if (tmp2->right) tmp2->right->set_parent(tmp1);
+		tmp2->right = tmp1;
+		tmp1->set_parent(tmp2);
+	}
+
+	void RRb(Node *node)
+	{
+		Node *tmp1, *tmp2, *tmp3, *tmp4;
+		tmp1 = node; tmp2 = node->left; tmp3 = node->right; tmp4 = node->right->right;
+		tmp3->set_parent(tmp1->parent());
+		if (tmp1->parent())
+		{
+			if (return_identity(tmp1) == LEFT) tmp3->parent()->left = tmp3;
+			else tmp3->parent()->right = tmp3;
+		}
+		else root = tmp3;
+		tmp1->right = tmp3->left;
+		if (tmp3->left) tmp3->left->set_parent(tmp1);
+		tmp3->left = tmp1;
+		tmp1->set_parent(tmp3);
+	}
+
+	void LRb(Node *node)
+	{
+		RRb(node->left);
+		LLb(node);
+	}
+
+	void RLb(Node *node)
+	{
+		LLb(node->right);
+		RRb(node);
+	}
+
+	void LL(Node *node)
+	{
+		LLb(node);
+		node->set_color(RED);
+		node->parent()->set_color(BLACK);
+	}
+
+	void RR(Node *node)
+	{
+		RRb(node);
+		node->set_color(RED);
+		node->parent()->set_color(BLACK);
+	}
+
+	void LR(Node *node)
+	{
+		LRb(node);
+		node->set_color(RED);
+		node->parent()->set_color(BLACK);
+	}
+
+	void RL(Node *node)
+	{
+		RLb(node);
+		node->set_color(RED);
+		node->parent()->set_color(BLACK);
+	}
+
+	void recolor(Node *node)
+	{
+		node->set_color(!node->color());
+		node->left->set_color(!node->left->color());
+		node->right->set_color(!node->right->color());
+	}
+
+	bool return_color(Node *node)
+	{
+		if (!node || node->color() == BLACK) return BLACK;
+		else return RED;
+	}
+
+	Node *return_brother(Node *node)
+	{
+		if (node->parent()->left == node) return node->parent()->right;
+		else return node->parent()->left;
+	}
+
+	bool return_identity(Node *node)
+	{
+		if (node->parent()->left == node) return LEFT;
+		else return RIGHT;
+	}
+
+	void adjust(Node *pos)
+	{
+		if (pos && pos->color() == BLACK && pos != root && return_brother(pos)->color() == BLACK)
+		{
+			Node *brother = return_brother(pos);
+			bool r_color = pos->parent()->color();
+			if (return_color(brother->left) == RED && return_color(brother->right) == RED)// brother has two red sons
+			{
+				if (return_identity(pos) == LEFT)
+				{
+					brother->parent()->set_color(BLACK);
+					brother->left->set_color(r_color);
+					RLb(pos->parent());
+				}
+				else
+				{
+					brother->parent()->set_color(BLACK);
+					brother->right->set_color(r_color);
+					LRb(pos->parent());
+				}
+			}
+			else if (return_color(brother->left) == RED || return_color(brother->right) == RED)// brother has one red son
+			{
+				if (return_identity(pos) == LEFT)
+				{
+					if (return_color(brother->right) == RED) { brother->set_color(r_color); brother->parent()->set_color(BLACK); brother->right->set_color(BLACK); RRb(pos->parent()); }
+					else { brother->parent()->set_color(BLACK); brother->left->set_color(r_color); RLb(pos->parent()); }
+				}
+				else
+				{
+					if (return_color(brother->left) == RED) { brother->set_color(r_color); brother->parent()->set_color(BLACK); brother->left->set_color(BLACK); LLb(pos->parent()); }
+					else { brother->parent()->set_color(BLACK); brother->right->set_color(r_color); LRb(pos->parent()); }
+				}
+			}
+			else// brother has no red sons
+			{
+				if (pos->parent()->color() == RED)
+				{
+					brother->set_color(RED);
+					pos->parent()->set_color(BLACK);
+				}
+				else if (pos->parent() == root)
+				{
+					brother->set_color(RED);
+				}
+				else
+				{
+					brother->set_color(RED);
+					Node *tmp = pos->parent();
+					while (tmp->color() == BLACK && tmp != root && return_color(return_brother(tmp)) == BLACK && return_color(return_brother(tmp)->left) == BLACK && return_color(return_brother(tmp)->right) == BLACK)
+					{
+						return_brother(tmp)->set_color(RED);
+						tmp = tmp->parent();
+					}
+					if (tmp == root);
+					else if(tmp->color() == RED) tmp->set_color(BLACK);
+					else if (return_color(return_brother(tmp)) == RED)
+					{
+						if (return_identity(tmp) == LEFT)
+						{
+							RRb(tmp->parent());
+							tmp->parent()->parent()->set_color(BLACK);
+							tmp->parent()->set_color(RED);
+							adjust(tmp);
+						}
+						else
+						{
+							LLb(tmp->parent());
+							tmp->parent()->parent()->set_color(BLACK);
+							tmp->parent()->set_color(RED);
+							adjust(tmp);
+						}
+					}
+					else
+					{
+						adjust(tmp);
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * hang a detached node into the tree and rebalance.
+	 * for a unique tree the key of node must not be in the tree yet.
+	 */
+	Node *link_node(Node *new_node)
+	{
+		new_node->set_color(RED);
+		node_size++;
+		if (!root) root = new_node;
+		else
+		{
+			Node *father = find_insert_parent(key_of(new_node), root);
+			new_node->set_parent(father);
+			if (cmp(key_of(new_node), key_of(father))) father->left = new_node;
+			else father->right = new_node;
+			if (return_color(father) == RED)
+			{
+				if (return_color(return_brother(father)) == BLACK)
+				{
+					if (return_identity(father) == LEFT && return_identity(new_node) == LEFT) LL(father->parent());
+					else if (return_identity(father) == LEFT && return_identity(new_node) == RIGHT) LR(father->parent());
+					else if (return_identity(father) == RIGHT && return_identity(new_node) == LEFT) RL(father->parent());
+					else RR(father->parent());
+				}
+				else
+				{
+					recolor(father->parent());
+					Node *check_node = father->parent();
+					while (check_node->parent() && check_node->parent()->color() == RED)
+					{
+						if (return_brother(check_node->parent())->color() == RED)
+						{
+							recolor(check_node->parent()->parent());
+							check_node = check_node->parent()->parent();
+						}
+						else
+						{
+							if (return_identity(check_node->parent()) == LEFT && return_identity(check_node) == LEFT) LL(check_node->parent()->parent());
+							else if (return_identity(check_node->parent()) == LEFT && return_identity(check_node) == RIGHT) LR(check_node->parent()->parent());
+							else if (return_identity(check_node->parent()) == RIGHT && return_identity(check_node) == LEFT) RL(check_node->parent()->parent());
+							else RR(check_node->parent()->parent());
+							break;
+						}
+					}
+				}
+			}
+		}
+		root->set_color(BLACK);
+		return new_node;
+	}
+
+	/**
+	 * exchange the places (links and colors) of target and change in the tree,
+	 * where change is the in-order predecessor of a target with two sons.
+	 */
+	void swap_node(Node *target, Node *change)
+	{
+		Node *change_parent = change->parent();
+		Node *change_left = change->left;// change->right is NULL
+		bool change_color = change->color();
+
+		if (target->parent())
+		{
+			if (return_identity(target) == LEFT) target->parent()->left = change;
+			else target->parent()->right = change;
+		}
+		else root = change;
+		change->set_parent(target->parent());
+		change->right = target->right; change->right->set_parent(change);
+		if (change_parent == target) {change->left = target; target->set_parent(change);}
+		else
+		{
+			change->left = target->left; change->left->set_parent(change);
+			change_parent->right = target; target->set_parent(change_parent);
+		}
+		change->set_color(target->color());
+
+		target->left = change_left; if (change_left) change_left->set_parent(target);
+		target->right = NULL;
+		target->set_color(change_color);
+	}
+
+	/**
+	 * take target out of the tree and rebalance.
+	 * the node itself is kept alive and returned with its links cleared.
+	 */
+	Node *unlink_node(Node *target)
+	{
+		node_size--;
+		if (target->left && target->right)
+		{
+			Node *change = target->left;
+			while (change->right) change = change->right;
+			swap_node(target, change);
+		}
+		if (!target->left && !target->right)
+		{
+			if (target == root) root = NULL;
+			else if (target->color() == RED)
+			{
+				if (return_identity(target) == LEFT) target->parent()->left = NULL;
+				else target->parent()->right = NULL;
+			}
+			else
+			{
+				Node *brother = return_brother(target);
+				if (return_color(brother) == RED)
+				{
+					target->parent()->set_color(RED);
+					brother->set_color(BLACK);
+					if (return_identity(target) == LEFT) RRb(target->parent());
+					else LLb(target->parent());
+				}
+				adjust(target);
+				if (return_identity(target) == LEFT) target->parent()->left = NULL;
+				else target->parent()->right = NULL;
+			}
+		}
+		else
+		{
+			Node *son = (target->left ? target->left : target->right);
+			if (target == root) root = son;
+			else if (return_identity(target) == LEFT) target->parent()->left = son;
+			else target->parent()->right = son;
+			son->set_parent(target->parent());
+			son->set_color(BLACK);
+		}
+		if (root) root->set_color(BLACK);
+		target->left = target->right = NULL; target->set_parent(NULL);
+		return target;
+	}
+
+	/**
+	 * in-order successor of a node in the tree, NULL after the last one.
+	 */
+	static Node *next_node(Node *node)
+	{
+		if (node->right)
+		{
+			node = node->right;
+			while (node->left) node = node->left;
+			return node;
+		}
+		while (node->parent() && node->parent()->right == node) node = node->parent();
+		return node->parent();
+	}
+public:
+	/**
+	 * see BidirectionalIterator at CppReference for help.
+	 *
+	 * if there is anything wrong throw invalid_iterator.
+	 *     like it = tree.begin(); --it;
+	 *       or it = tree.end(); ++end();
+	 */
+	class const_iterator;
+	class iterator {
+	public:
+		/**
+		* TODO add data members
+		*   just add whatever you want.
+		*/
+		Node *itr;
+		Node *root_itr;
+		Node *end_itr;
+		Node *add(void)
+		{
+			Node *ans;
+			if(!itr) return end_itr;
+			else if (itr->right)
+			{
+				ans = itr->right;
+				while (ans->left) ans = ans->left;
+				return ans;
+			}
+			else
+			{
+				if (!itr->parent()) return end_itr;// no bigger one
+				if (itr->parent()->left == itr) return itr->parent();
+				else
+				{
+					ans = itr;
+					while (ans->parent()->right == ans)
+					{
+						ans = ans->parent();
+						if (!ans->parent()) return end_itr;// no bigger one
+					}
+					return ans->parent();
+				}
+			}
+		}
+		Node *subtract(void)
+		{
+			Node *ans;
+			if(!itr)
+            {
+                ans = root_itr;
+                if(!ans) return end_itr;
+                while(ans->right) ans = ans->right;
+                return ans;
+            }
+            else if(itr == end_itr)
+            {
+                ans = root_itr;
+                if(!ans) return end_itr;
+                while(ans->right) ans = ans->right;
+                return ans;
+            }
+			else if (itr->left)
+			{
+				ans = itr->left;
+				while (ans->right) {ans = ans->right;}
+				return ans;
+			}
+			else
+			{
+				if (!itr->parent()) return NULL;// no smaller one
+				if (itr->parent()->right == itr) {return itr->parent();}
+				else
+				{
+					ans = itr;
+					while (ans->parent()->left == ans)
+					{
+						ans = ans->parent();
+						if (!ans->parent()) return NULL;// no bigger one
+					}
+					return ans->parent();
+				}
+			}
+		}
+	public:
+		iterator() :itr(NULL), root_itr(NULL), end_itr(NULL) {}
+		iterator(const iterator &other) { itr = other.itr; root_itr = other.root_itr; end_itr = other.end_itr; }
+		iterator(Node *node, Node *r, Node *e) { itr = node; root_itr = r; end_itr = e;}
+		/**
+		* return a new iterator which pointer n-next elements
+		*   even if there are not enough elements, just return the answer.
+		* as well as operator-
+		*/
+		/**
+		* TODO iter++
+		*/
+		iterator operator++(int)
+		{
+			iterator ans(*this);
+			itr = add();
+			return ans;
+		}
+		/**
+		* TODO ++iter
+		*/
+		iterator & operator++()
+		{
+			itr = add();
+			return *this;
+		}
+		/**
+		* TODO iter--
+		*/
+		iterator operator--(int)
+		{
+			iterator ans(*this);
+			itr = subtract();
+			return ans;
+		}
+		/**
+		* TODO --iter
+		*/
+		iterator & operator--()
+		{
+			itr = subtract();
+			return *this;
+		}
+		/**
+		* a operator to check whether two iterators are same (pointing to the same memory).
+		*/
+		value_type & operator*() const { return itr->data; }
+		bool operator==(const iterator &rhs) const { return (itr == rhs.itr ? 1 : 0); }
+		bool operator==(const const_iterator &rhs) const { return (itr == rhs.itr ? 1 : 0); }
+		/**
+		* some other operator for iterator.
+		*/
+		bool operator!=(const iterator &rhs) const { return (itr != rhs.itr ? 1 : 0); }
+		bool operator!=(const const_iterator &rhs) const { return (itr != rhs.itr ? 1 : 0); }
+		/**
+		*assignment function
+		*/
+		iterator &operator=(Node *node){ itr = node; return *this; }
+		/**
+		* for the support of it->first.
+		* See <http://kelvinh.github.io/blog/2013/11/20/overloading-of-member-access-operator-dash-greater-than-symbol-in-cpp/> for help.
+		*/
+		value_type* operator->() const noexcept{ return &(itr->data); }
+		Node *return_node(void){ return itr; }
+	};
+	class const_iterator {
+		// it should has similar member method as iterator.
+		//  and it should be able to construct from an iterator.
+	public:
+		const Node *itr;
+		const Node *root_itr;
+		const Node *end_itr;
+		const Node *add(void)
+		{
+			const Node *ans;
+			if(!itr) return end_itr;
+			else if (itr->right)
+			{
+				ans = itr->right;
+				while (ans->left) ans = ans->left;
+				return ans;
+			}
+			else
+			{
+				if (!itr->parent()) return end_itr;// no bigger one
+				if (itr->parent()->left == itr) return itr->parent();
+				else
+				{
+					ans = itr;
+					while (ans->parent()->right == ans)
+					{
+						ans = ans->parent();
+						if (!ans->parent()) return end_itr;// no bigger one
+					}
+					return ans->parent();
+				}
+			}
+		}
+		const Node *subtract(void)
+		{
+			const Node *ans;
+			if(!itr)
+            {
+                ans = root_itr;
+                if(!ans) return end_itr;
+                while(ans->right) ans = ans->right;
+                return ans;
+            }
+            else if(itr == end_itr)
+            {
+                ans = root_itr;
+                if(!ans) return end_itr;
+                while(ans->right) ans = ans->right;
+                return ans;
+            }
+			else if (itr->left)
+			{
+				ans = itr->left;
+				while (ans->right) ans = ans->right;
+				return ans;
+			}
+			else
+			{
+				if (!itr->parent()) return NULL;// no bigger one
+				if (itr->parent()->right == itr) return itr->parent();
+				else
+				{
+					ans = itr;
+					while (ans->parent()->left == ans)
+					{
+						ans = ans->parent();
+						if (!ans->parent()) return NULL;// no bigger one
+					}
+					return ans->parent();
+				}
+			}
+		}
+	public:
+		const_iterator() :itr(NULL){}
+		const_iterator(const const_iterator &other) { itr = other.itr; root_itr = other.root_itr; end_itr = other.end_itr;}
+		const_iterator(const iterator &other) { itr = other.itr; root_itr = other.root_itr; end_itr = other.end_itr; }
+		const_iterator(const Node *node, const Node *r, const Node *e) { itr = node; root_itr = r; end_itr = e;}
+		/**
+		* return a new iterator which pointer n-next elements
+		*   even if there are not enough elements, just return the answer.
+		* as well as operator-
+		*/
+		/**
+		* TODO iter++
+		*/
+		const_iterator operator++(int)
+		{
+			const_iterator ans(*this);
+			itr = add();
+			return ans;
+		}
+		/**
+		* TODO ++iter
+		*/
+		const_iterator & operator++()
+		{
+			itr = add();
+			return *this;
+		}
+		/**
+		* TODO iter--
+		*/
+		const_iterator operator--(int)
+		{
+			const_iterator ans(*this);
+			itr = subtract();
+			return ans;
+		}
+		/**
+		* TODO --iter
+		*/
+		const_iterator & operator--()
+		{
+			itr = subtract();
+			return *this;
+		}
+		/**
+		* a operator to check whether two iterators are same (pointing to the same memory).
+		*/
+		const value_type & operator*() const { return itr->data; }
+		bool operator==(const iterator &rhs) const { return (itr == rhs.itr ? 1 : 0); }
+		bool operator==(const const_iterator &rhs) const { return (itr == rhs.itr ? 1 : 0); }
+		/**
+		* some other operator for iterator.
+		*/
+		bool operator!=(const iterator &rhs) const { return (itr != rhs.itr ? 1 : 0); }
+		bool operator!=(const const_iterator &rhs) const { return (itr != rhs.itr ? 1 : 0); }
+		/**
+		*assignment function
+		*/
+		const_iterator &operator=(Node *node){ itr = node; return *this; }
+		/**
+		* for the support of it->first.
+		* See <http://kelvinh.github.io/blog/2013/11/20/overloading-of-member-access-operator-dash-greater-than-symbol-in-cpp/> for help.
+		*/
+		const value_type* operator->() const noexcept{ return &(itr->data); }
+		const Node *return_node(void){ return itr; }
+	};
+	/**
+	 * a node handle owns one element taken out of a tree by extract().
+	 * it can be inserted into another container of the same type
+	 *   without reallocating or copying the element.
+	 */
+	class node_type {
+		friend class rb_tree;
+		Node *node;
+		explicit node_type(Node *other_node) :node(other_node){}
+	public:
+		typedef Key key_type;
+		typedef Value value_type;
+		node_type() :node(NULL){}
+		node_type(const node_type &other) = delete;
+		node_type(node_type &&other) :node(other.node){ other.node = NULL; }
+		node_type & operator=(const node_type &other) = delete;
+		node_type & operator=(node_type &&other)
+		{
+			if (this == &other) return *this;
+			if (node) free_node(node);
+			node = other.node;
+			other.node = NULL;
+			return *this;
+		}
+		~node_type(){ if (node) free_node(node); }
+		bool empty() const { return !node; }
+		explicit operator bool() const { return node != NULL; }
+		/**
+		 * access the element, throw container_is_empty if the handle is empty.
+		 * mapped() only exists when the element is a pair.
+		 */
+		const key_type & key() const
+		{
+			if (!node) throw container_is_empty();
+			return key_of(node);
+		}
+		value_type & value() const
+		{
+			if (!node) throw container_is_empty();
+			return node->data;
+		}
+		template<class V = Value>
+		auto mapped() const -> decltype((static_cast<V *>(NULL)->second))
+		{
+			if (!node) throw container_is_empty();
+			return node->data.second;
+		}
+	};
+	/**
+	 * the result of insert(node_type &&) for unique keys.
+	 * on failure node gives the handle back to the caller.
+	 */
+	struct insert_return_type {
+		iterator position;
+		bool inserted;
+		node_type node;
+	};
+	/**
+	 * unique trees report whether an insertion happened,
+	 *   the others always insert and just return the position.
+	 */
+	typedef typename std::conditional<Unique, pair<iterator, bool>, iterator>::type insert_result;
+	typedef typename std::conditional<Unique, insert_return_type, iterator>::type node_insert_result;
+
+protected:
+	pair<iterator, bool> insert_value(const value_type &value, std::true_type)
+	{
+		Node *target = find_node(KeyOfValue()(value), root);
+		if (target) return pair<iterator, bool>(iterator(target, root, end_node), false);
+		Node *new_node = link_node(new Node(value));
+		return pair<iterator, bool>(iterator(new_node, root, end_node), true);
+	}
+
+	iterator insert_value(const value_type &value, std::false_type)
+	{
+		Node *new_node = link_node(new Node(value));
+		return iterator(new_node, root, end_node);
+	}
+
+	insert_return_type insert_node(node_type &&nh, std::true_type)
+	{
+		if (nh.empty()) return insert_return_type{end(), false, node_type()};
+		Node *target = find_node(key_of(nh.node), root);
+		if (target) return insert_return_type{iterator(target, root, end_node), false, std::move(nh)};
+		Node *new_node = link_node(nh.node);
+		nh.node = NULL;
+		return insert_return_type{iterator(new_node, root, end_node), true, node_type()};
+	}
+
+	iterator insert_node(node_type &&nh, std::false_type)
+	{
+		if (nh.empty()) return end();
+		Node *new_node = link_node(nh.node);
+		nh.node = NULL;
+		return iterator(new_node, root, end_node);
+	}
+
+	template<class K>
+	size_t count_node(const K &key) const
+	{
+		if (Unique) return first_node(key) ? 1 : 0;
+		size_t ans = 0;
+		for (Node *node = first_node(key); node && !cmp(key, key_of(node)); node = next_node(node)) ans++;
+		return ans;
+	}
+
+public:
+	rb_tree() :root(NULL), end_node(new Node()), node_size(0){}
+	rb_tree(const rb_tree &other)
+	{
+	    copy_node(root, NULL, other.root); node_size = other.node_size;
+	    end_node = new Node();
+    }
+	rb_tree & operator=(const rb_tree &other)
+	{
+		if (this == &other) return *this;
+		destroy_node(root);
+		copy_node(root, NULL, other.root);
+		node_size = other.node_size;
+		return *this;
+	}
+	~rb_tree()
+	{
+	    destroy_node(root);
+	    delete end_node;
+    }
+	/**
+	 * return a iterator to the beginning
+	 */
+	iterator begin()
+	{
+		Node *target = root;
+		if (!target)
+		{
+			iterator ans(end_node, root, end_node);
+			return ans;
+		}
+		else
+		{
+			while (target->left) target = target->left;
+			iterator ans(target, root, end_node);
+			return ans;
+		}
+	}
+	const_iterator cbegin() const
+	{
+		Node *target = root;
+		if (!target)
+		{
+			const_iterator ans(end_node, root, end_node);
+			return ans;
+		}
+		else
+		{
+			while (target->left) target = target->left;
+			const_iterator ans(target, root, end_node);
+			return ans;
+		}
+	}
+	/**
+	 * return a iterator to the end
+	 * in fact, it returns past-the-end.
+	 */
+	iterator end()
+	{
+		iterator ans(end_node, root, end_node);
+		return ans;
+	}
+	const_iterator cend() const
+	{
+		const_iterator ans(end_node, root, end_node);
+		return ans;
+	}
+	/**
+	 * checks whether the container is empty
+	 * return true if empty, otherwise false.
+	 */
+	bool empty() const { return (node_size == 0);}
+	/**
+	 * returns the number of elements.
+	 */
+	size_t size() const { return node_size; }
+	/**
+	 * clears the contents
+	 */
+	void clear()
+	{
+		destroy_node(root);
+		root = NULL;
+		node_size = 0;
+	}
+	/**
+	 * insert an element.
+	 * for unique keys return a pair, the first of the pair is
+	 *   the iterator to the new element (or the element that prevented the insertion),
+	 *   the second one is true if insert successfully, or false.
+	 * otherwise the element is put after the equal ones and its iterator is returned.
+	 */
+	insert_result insert(const value_type &value)
+	{
+		return insert_value(value, is_unique());
+	}
+	/**
+	 * insert the element owned by a node handle, no copy of the element is made.
+	 * for unique keys, if the key already exists, nothing is inserted,
+	 *   position points to the existing element and node keeps the handle.
+	 */
+	node_insert_result insert(node_type &&nh)
+	{
+		return insert_node(std::move(nh), is_unique());
+	}
+	/**
+	 * erase the element at pos.
+	 *
+	 * throw if pos pointed to a bad element (pos == this->end() || pos points an element out of this)
+	 */
+	void erase(iterator pos)
+	{
+		if (!pos.return_node() || pos.return_node() == end_node || pos.end_itr != end_node) throw index_out_of_bound();
+		free_node(unlink_node(pos.return_node()));
+	}
+	/**
+	 * erase all the elements with key, return how many were erased.
+	 */
+	size_t erase(const Key &key)
+	{
+		size_t ans = 0;
+		Node *node = first_node(key);
+		while (node && !cmp(key, key_of(node)))
+		{
+			Node *next = next_node(node);
+			free_node(unlink_node(node));
+			ans++;
+			node = next;
+		}
+		return ans;
+	}
+	/**
+	 * unlink the element at pos and hand it over in a node handle.
+	 *
+	 * throw like erase() if pos pointed to a bad element.
+	 */
+	node_type extract(iterator pos)
+	{
+		if (!pos.return_node() || pos.return_node() == end_node || pos.end_itr != end_node) throw index_out_of_bound();
+		return node_type(unlink_node(pos.return_node()));
+	}
+	/**
+	 * unlink the (first) element with key, return an empty handle if there is no such element.
+	 */
+	node_type extract(const Key &key)
+	{
+		Node *target = first_node(key);
+		if (!target) return node_type();
+		return node_type(unlink_node(target));
+	}
+	/**
+	 * move the elements of source into this tree.
+	 * nodes are relinked, the elements are never copied or reallocated.
+	 * for unique keys, elements whose key is already here stay in source.
+	 */
+	void merge(rb_tree &source)
+	{
+		if (this == &source) return;
+		Node *node = source.root;
+		if (!node) return;
+		while (node->left) node = node->left;
+		while (node)
+		{
+			Node *next = next_node(node);
+			if (!Unique || !find_node(key_of(node), root)) link_node(source.unlink_node(node));
+			node = next;
+		}
+	}
+	/**
+	 * Returns the number of elements with key
+	 *   that compares equivalent to the specified argument,
+	 *   which is either 1 or 0 for unique keys.
+	 * The default method of check the equivalence is !(a < b || b > a)
+	 */
+	size_t count(const Key &key) const { return count_node(key); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	size_t count(const K &key) const { return count_node(key); }
+	/**
+	 * Finds an element with key equivalent to key.
+	 * key value of the element to search for.
+	 * Iterator to an element with key equivalent to key, the first one if there are several.
+	 *   If no such element is found, past-the-end (see end()) iterator is returned.
+	 */
+	iterator find(const Key &key)
+	{
+		Node *target = first_node(key);
+		if(target) {iterator ans(target, root, end_node);return ans;}
+		else {iterator ans(end_node, root, end_node);return ans;}
+	}
+	const_iterator find(const Key &key) const
+	{
+		const Node *target = first_node(key);
+		if(target) {const_iterator ans(target, root, end_node);return ans;}
+		else {const_iterator ans(end_node, root, end_node);return ans;}
+	}
+	/**
+	 * find() with any key type comparable with Key,
+	 *   only available when Compare::is_transparent exists (like std::less<>).
+	 */
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator find(const K &key)
+	{
+		Node *target = first_node(key);
+		if(target) {iterator ans(target, root, end_node);return ans;}
+		else {iterator ans(end_node, root, end_node);return ans;}
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator find(const K &key) const
+	{
+		const Node *target = first_node(key);
+		if(target) {const_iterator ans(target, root, end_node);return ans;}
+		else {const_iterator ans(end_node, root, end_node);return ans;}
+	}
+	/**
+	 * Returns an iterator to the first element not less than key,
+	 *   past-the-end if there is no such element.
+	 */
+	iterator lower_bound(const Key &key)
+	{
+		Node *target = lower_node(key);
+		return iterator(target ? target : end_node, root, end_node);
+	}
+	const_iterator lower_bound(const Key &key) const
+	{
+		Node *target = lower_node(key);
+		return const_iterator(target ? target : end_node, root, end_node);
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator lower_bound(const K &key)
+	{
+		Node *target = lower_node(key);
+		return iterator(target ? target : end_node, root, end_node);
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator lower_bound(const K &key) const
+	{
+		Node *target = lower_node(key);
+		return const_iterator(target ? target : end_node, root, end_node);
+	}
+	/**
+	 * Returns an iterator to the first element greater than key,
+	 *   past-the-end if there is no such element.
+	 */
+	iterator upper_bound(const Key &key)
+	{
+		Node *target = upper_node(key);
+		return iterator(target ? target : end_node, root, end_node);
+	}
+	const_iterator upper_bound(const Key &key) const
+	{
+		Node *target = upper_node(key);
+		return const_iterator(target ? target : end_node, root, end_node);
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator upper_bound(const K &key)
+	{
+		Node *target = upper_node(key);
+		return iterator(target ? target : end_node, root, end_node);
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator upper_bound(const K &key) const
+	{
+		Node *target = upper_node(key);
+		return const_iterator(target ? target : end_node, root, end_node);
+	}
+	/**
+	 * Returns the range of elements with key equivalent to key,
+	 *   as a pair of lower_bound() and upper_bound().
+	 */
+	pair<iterator, iterator> equal_range(const Key &key)
+	{
+		return pair<iterator, iterator>(lower_bound(key), upper_bound(key));
+	}
+	pair<const_iterator, const_iterator> equal_range(const Key &key) const
+	{
+		return pair<const_iterator, const_iterator>(lower_bound(key), upper_bound(key));
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	pair<iterator, iterator> equal_range(const K &key)
+	{
+		return pair<iterator, iterator>(lower_bound(key), upper_bound(key));
+	}
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	pair<const_iterator, const_iterator> equal_range(const K &key) const
+	{
+		return pair<const_iterator, const_iterator>(lower_bound(key), upper_bound(key));
+	}
+	Node *return_root(void){return root;}
+};
+
+}
+
+#endif
@@ -0,0 +1,45 @@
+/**
+ * implement containers like std::set and std::multiset
+ */
+#ifndef SJTU_SET_HPP
+#define SJTU_SET_HPP
+
+// only for std::less<T>
+#include <functional>
+#include <cstddef>
+#include "utility.hpp"
+#include "exceptions.hpp"
+#include "../map/rb_tree.hpp"
+
+namespace sjtu {
+
+/**
+ * a set keeps only the keys in the red-black tree of rb_tree.hpp,
+ *   so a node costs no more than the key and its links.
+ * the elements are const, *it gives a const Key &.
+ */
+template<
+	class Key,
+	class Compare = std::less<Key>,
+	class Layout = plain_layout
+> class set : public rb_tree<Key, const Key, identity<Key>, Compare, true, Layout> {
+public:
+	typedef Key value_type;
+};
+
+/**
+ * a set allowing equal keys, equal keys are kept in insertion order.
+ * insert() always inserts and returns the iterator to the new element.
+ */
+template<
+	class Key,
+	class Compare = std::less<Key>,
+	class Layout = plain_layout
+> class multiset : public rb_tree<Key, const Key, identity<Key>, Compare, false, Layout> {
+public:
+	typedef Key value_type;
+};
+
+}
+
+#endif
@@ -5,6 +5,8 @@
 
 #include <climits>
 #include <cstddef>
+#include <new>
+#include <utility>
 
 namespace sjtu {
 /**
@@ -14,22 +16,38 @@ namespace sjtu {
 template<typename T>
 class vector {
 private:
-    T **ptr;
+    T *ptr;// raw storage, only [0, currentSize) is constructed
     size_t maxSize;
     size_t currentSize;
-    void resize(void)
+    static T *allocate(size_t n)
+    {
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    void reallocate(size_t newSize)
     {
-        T **tmp;
-        tmp = new T *[2 * maxSize];
+        T *tmp = allocate(newSize);
         size_t index;
         for(index = 0; index < currentSize; index++)
         {
-            tmp[index] = new T(*(ptr[index]));
-            delete ptr[index];
+            new (tmp + index) T(std::move(ptr[index]));
+            ptr[index].~T();
         }
-        delete []ptr;
+        ::operator delete(ptr);
         ptr = tmp;
-        maxSize *= 2;
+        maxSize = newSize;
+    }
+    void resize(void)
+    {
+        reallocate(maxSize ? 2 * maxSize : 1);
+    }
+    void destroy(void)
+    {
+        size_t index;
+        for(index = 0; index < currentSize; index++)
+        {
+            ptr[index].~T();
+        }
+        currentSize = 0;
     }
 public:
 	/**
@@ -42,12 +60,13 @@ public:
 	 */
 	class const_iterator;
 	class iterator {
+		friend class vector;
 	private:
 		/**
 		 * TODO add data members
 		 *   just add whatever you want.
 		 */
-		 T **itr;
+		 T *itr;
 		 size_t pos;
 	public:
 		/**
@@ -55,7 +74,7 @@ public:
 		 *   even if there are not enough elements, just return the answer.
 		 * as well as operator-
 		 */
-        iterator(T **other_itr = nullptr, size_t other_pos = 0):itr(other_itr), pos(other_pos){}
+        iterator(T *other_itr = nullptr, size_t other_pos = 0):itr(other_itr), pos(other_pos){}
         iterator &operator=(iterator &other)
         {
             itr = other.itr;
@@ -130,14 +149,14 @@ public:
 		 */
 		iterator& operator--()
 		{
-		    itr += 1;
-		    pos += 1;
+		    itr -= 1;
+		    pos -= 1;
 		    return *this;
 		}
 		/**
 		 * TODO *it
 		 */
-		T& operator*() const{return **itr;}
+		T& operator*() const{return *itr;}
 		/**
 		 * a operator to check whether two iterators are same (pointing to the same memory).
 		 */
@@ -159,7 +178,7 @@ public:
 		 * TODO add data members
 		 *   just add whatever you want.
 		 */
-		 T *const*itr;
+		 const T *itr;
 		 size_t pos;
 	public:
 		/**
@@ -167,7 +186,7 @@ public:
 		 *   even if there are not enough elements, just return the answer.
 		 * as well as operator-
 		 */
-        const_iterator(T *const*other_itr = nullptr, size_t other_pos = 0){itr=other_itr; pos=other_pos;}
+        const_iterator(const T *other_itr = nullptr, size_t other_pos = 0){itr=other_itr; pos=other_pos;}
         const_iterator &operator=(const_iterator &other)
         {
             itr = other.itr;
@@ -242,14 +261,14 @@ public:
 		 */
 		const_iterator& operator--()
 		{
-		    itr += 1;
-		    pos += 1;
+		    itr -= 1;
+		    pos -= 1;
 		    return *this;
 		}
 		/**
 		 * TODO *it
 		 */
-		const T& operator*() const{return **itr;}
+		const T& operator*() const{return *itr;}
 		/**
 		 * a operator to check whether two iterators are same (pointing to the same memory).
 		 */
@@ -270,17 +289,17 @@ public:
 	{
 	    maxSize = 100;
 	    currentSize = 0;
-	    ptr = new T*[maxSize];
+	    ptr = allocate(maxSize);
 	}
 	vector(const vector &other)
 	{
 	    maxSize = other.maxSize;
 	    currentSize = other.currentSize;
-	    ptr = new T*[maxSize];
+	    ptr = allocate(maxSize);
 	    size_t index;
 	    for(index = 0; index < currentSize; index++)
         {
-            (ptr[index]) = new T(*(other.ptr[index]));
+            new (ptr + index) T(other.ptr[index]);
         }
 	}
 	/**
@@ -288,12 +307,8 @@ public:
 	 */
 	~vector()
 	{
-	    size_t index;
-	    for(index = 0; index < currentSize; index++)
-        {
-            delete ptr[index];
-        }
-        delete []ptr;
+	    destroy();
+	    ::operator delete(ptr);
 	}
 	/**
 	 * TODO Assignment operator
@@ -303,19 +318,19 @@ public:
 	    if(this == &other) return *this;
 	    else
         {
-            size_t index;
-            for(index = 0; index < currentSize; index++)
+            destroy();
+            if(maxSize < other.currentSize)
             {
-                delete ptr[index];
+                ::operator delete(ptr);
+                ptr = allocate(other.maxSize);
+                maxSize = other.maxSize;
             }
-            delete []ptr;
-            maxSize = other.maxSize;
-            currentSize = other.currentSize;
-            ptr = new T*[maxSize];
-            for(index = 0; index < currentSize; index++)
+            size_t index;
+            for(index = 0; index < other.currentSize; index++)
             {
-                ptr[index] = new T(*(other.ptr[index]));
+                new (ptr + index) T(other.ptr[index]);
             }
+            currentSize = other.currentSize;
             return *this;
         }
 	}
@@ -326,12 +341,12 @@ public:
 	T & at(const size_t &pos)
 	{
 	    if(pos < 0 || pos >= currentSize) throw index_out_of_bound();
-	    else return *ptr[pos];
+	    else return ptr[pos];
 	}
 	const T & at(const size_t &pos) const
 	{
 	    if(pos < 0 || pos >= currentSize) throw index_out_of_bound();
-	    else return *ptr[pos];
+	    else return ptr[pos];
 	}
 	/**
 	 * assigns specified element with bounds checking
@@ -342,12 +357,12 @@ public:
 	T & operator[](const size_t &pos)
 	{
 	    if(pos < 0 || pos >= currentSize) throw index_out_of_bound();
-	    else return *ptr[pos];
+	    else return ptr[pos];
 	}
 	const T & operator[](const size_t &pos) const
 	{
 	    if(pos < 0 || pos >= currentSize) throw index_out_of_bound();
-	    else return *ptr[pos];
+	    else return ptr[pos];
 	}
 	/**
 	 * access the first element.
@@ -356,7 +371,7 @@ public:
 	const T & front() const
 	{
 	    if(!currentSize) throw container_is_empty();
-	    else return *ptr[0];
+	    else return ptr[0];
 	}
 	/**
 	 * access the last element.
@@ -365,7 +380,7 @@ public:
 	const T & back() const
 	{
 	    if(!currentSize) throw container_is_empty();
-	    else return *ptr[currentSize - 1];
+	    else return ptr[currentSize - 1];
 	}
 	/**
 	 * returns an iterator to the beginning.
@@ -389,17 +404,24 @@ public:
 	 * returns the number of elements that can be held in currently allocated storage.
 	 */
 	size_t capacity() const {return maxSize;}
+	/**
+	 * increase the capacity to at least n, so that the next pushes do not reallocate.
+	 */
+	void reserve(size_t n)
+	{
+	    if(n > maxSize) reallocate(n);
+	}
+	/**
+	 * returns a pointer to the successive storage, valid until the next reallocation.
+	 */
+	T * data() {return ptr;}
+	const T * data() const {return ptr;}
 	/**
 	 * clears the contents
 	 */
 	void clear()
 	{
-	    size_t index;
-	    for(index = 0; index < currentSize; index++)
-        {
-            delete ptr[index];
-        }
-	    currentSize = 0;
+	    destroy();
     }
 	/**
 	 * inserts value before pos
@@ -407,16 +429,7 @@ public:
 	 */
 	iterator insert(iterator pos, const T &value)
 	{
-	    if(currentSize == maxSize)resize();
-        iterator itr = end();
-        ptr[currentSize] = new T(value);
-        for(;itr != pos; itr--)
-        {
-            *itr = *(itr-1);
-        }
-        *pos = value;
-        currentSize++;
-        return pos;
+	    return insert(pos.pos, value);
 	}
 	/**
 	 * inserts value at index ind.
@@ -429,21 +442,26 @@ public:
 	    if(ind < 0 || ind > currentSize) throw index_out_of_bound();
 	    else
         {
+            if(&value >= ptr && &value < ptr + currentSize)
+            {
+                T tmp(value);// value lives in this vector and is about to move
+                return insert(ind, tmp);
+            }
             if(currentSize == maxSize) resize();
             if(ind == currentSize)
             {
-                ptr[currentSize] = new T(value);
+                new (ptr + currentSize) T(value);
                 currentSize++;
             }
             else
             {
                 size_t index;
-                ptr[currentSize] = new T(value);
-                for(index = currentSize; index != ind; index--)
+                new (ptr + currentSize) T(std::move(ptr[currentSize - 1]));
+                for(index = currentSize - 1; index != ind; index--)
                 {
-                    *ptr[index] = *ptr[index-1];
+                    ptr[index] = std::move(ptr[index-1]);
                 }
-                *ptr[ind] = value;
+                ptr[ind] = value;
                 currentSize++;
             }
             iterator ans(ptr + ind, ind);
@@ -457,22 +475,7 @@ public:
 	 */
 	iterator erase(iterator pos)
 	{
-	    if(pos == end() - 1)
-        {
-            delete ptr[--currentSize];
-            return end()-1;
-        }
-        else
-        {
-            iterator itr;
-            iterator itre = end() - 1;
-            for(itr = pos; itr != itre; itr++)
-            {
-                *itr = *(itr+1);
-            }
-            delete ptr[--currentSize];
-            return pos;
-        }
+	    return erase(pos.pos);
 	}
 	/**
 	 * removes the element with index ind.
@@ -484,22 +487,14 @@ public:
 	    if(ind < 0 || ind >= currentSize) throw index_out_of_bound();
 	    else
 	    {
-	        if(ind == currentSize - 1)
+            size_t index;
+            for(index = ind; index + 1 < currentSize; index++)
             {
-                delete ptr[--currentSize];
-                return end() - 1;
-            }
-            else
-            {
-                size_t index;
-                for(index = ind; index != currentSize - 1; index++)
-                {
-                    *ptr[index] = *ptr[index+1];
-                }
-                iterator ans(ptr+ind, ind);
-                delete ptr[--currentSize];
-                return ans;
+                ptr[index] = std::move(ptr[index+1]);
             }
+            ptr[--currentSize].~T();
+            iterator ans(ptr + ind, ind);
+            return ans;
 	    }
 	}
 	/**
@@ -507,8 +502,13 @@ public:
 	 */
 	void push_back(const T &value)
 	{
-	    if(currentSize == maxSize) resize();
-	    ptr[currentSize++] = new T(value);
+	    if(currentSize == maxSize)
+	    {
+	        T tmp(value);// value may live in this vector
+	        resize();
+	        new (ptr + currentSize++) T(std::move(tmp));
+	    }
+	    else new (ptr + currentSize++) T(value);
 	}
 	/**
 	 * remove the last element from the end.
@@ -517,7 +517,7 @@ public:
 	void pop_back()
 	{
 	    if(!currentSize) throw container_is_empty();
-	    else delete ptr[--currentSize];
+	    else ptr[--currentSize].~T();
 	}
 };
 